@@ -0,0 +1,116 @@
+#pragma once
+#include "physicsBody.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Uniform grid used as the broadphase of Engine::solveCollisions.
+// The cell size is the largest body diameter, so two overlapping circles
+// always fall in the same or in neighbouring cells.
+class CollisionGrid
+{
+private:
+    glm::vec2 origin = glm::vec2(0.0f, 0.0f);
+    float cellSize = 1.0f;
+    int cols = 1;
+    int rows = 1;
+    std::vector<int> cellStart;  // cols * rows + 1 offsets into cellBodies
+    std::vector<int> cellBodies; // body indices, grouped by cell
+    std::vector<int> bodyCell;
+    std::vector<int> cellFill;
+    std::vector<int> candidates;
+
+    int cellCoord(float value, float start, int count) const
+    {
+        int c = static_cast<int>(std::floor((value - start) / cellSize));
+        return std::clamp(c, 0, count - 1);
+    }
+
+public:
+    void build(const std::vector<PhysicsBodyPtr> &bodies, glm::vec2 areaMin, glm::vec2 areaMax)
+    {
+        float maxRadius = 0.0f;
+        glm::vec2 lo(FLT_MAX, FLT_MAX);
+        glm::vec2 hi(-FLT_MAX, -FLT_MAX);
+        for (auto &body : bodies)
+        {
+            glm::vec2 pos = body->getPosition();
+            maxRadius = std::max(maxRadius, body->getRadius());
+            lo = glm::min(lo, pos);
+            hi = glm::max(hi, pos);
+        }
+
+        // Bodies are kept inside the area, so the grid only spans the occupied part of it.
+        // Anything outside is clamped to the border cells, which keeps neighbours adjacent.
+        lo = glm::clamp(lo, areaMin, areaMax);
+        hi = glm::clamp(hi, lo, areaMax);
+
+        cellSize = std::max(2.0f * maxRadius, 1e-4f);
+        // Very tall areas (proj1 uses maxY = 1000) or tiny radii would produce
+        // far more cells than bodies; coarser cells stay correct, just less selective.
+        const double maxCells = 4.0 * static_cast<double>(bodies.size()) + 16.0;
+        while ((std::floor((hi.x - lo.x) / cellSize) + 1.0) * (std::floor((hi.y - lo.y) / cellSize) + 1.0) > maxCells)
+        {
+            cellSize *= 2.0f;
+        }
+        origin = lo;
+        cols = static_cast<int>(std::floor((hi.x - lo.x) / cellSize)) + 1;
+        rows = static_cast<int>(std::floor((hi.y - lo.y) / cellSize)) + 1;
+
+        // Counting sort of the bodies by cell.
+        cellStart.assign(static_cast<size_t>(cols) * rows + 1, 0);
+        bodyCell.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            glm::vec2 pos = bodies[i]->getPosition();
+            int cell = cellCoord(pos.y, origin.y, rows) * cols + cellCoord(pos.x, origin.x, cols);
+            bodyCell[i] = cell;
+            cellStart[cell + 1]++;
+        }
+        for (size_t c = 1; c < cellStart.size(); c++)
+        {
+            cellStart[c] += cellStart[c - 1];
+        }
+        cellBodies.resize(bodies.size());
+        cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            cellBodies[cellFill[bodyCell[i]]++] = static_cast<int>(i);
+        }
+    }
+
+    // Calls solve(i, j) for every candidate pair with i < j, in the same order
+    // as the brute-force double loop. Both paths give identical results unless a
+    // correction carries a body further than a cell during the pass.
+    template <typename Solve>
+    void forEachPair(Solve solve)
+    {
+        for (size_t i = 0; i < bodyCell.size(); i++)
+        {
+            int cx = bodyCell[i] % cols;
+            int cy = bodyCell[i] / cols;
+
+            candidates.clear();
+            for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, rows - 1); y++)
+            {
+                for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, cols - 1); x++)
+                {
+                    int cell = y * cols + x;
+                    for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+                    {
+                        if (cellBodies[k] > static_cast<int>(i))
+                            candidates.push_back(cellBodies[k]);
+                    }
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            for (int j : candidates)
+            {
+                solve(i, static_cast<size_t>(j));
+            }
+        }
+    }
+};
@@ -1,20 +1,30 @@
 #pragma once
 #include "physicsBody.h"
+#include "collisionGrid.h"
 #include <glm/glm.hpp>
 
 class Engine;
 using EnginePtr = std::shared_ptr<Engine>;
 
+enum class Broadphase
+{
+    BruteForce, // tests every pair, kept for comparison
+    Grid
+};
+
 class Engine
 {
 private:
     glm::vec2 gravity = glm::vec2(0.0f, -9.81f);
     int numSubsteps;
+    int solverSteps;
     std::vector<PhysicsBodyPtr> bodies;
+    Broadphase broadphase = Broadphase::Grid;
+    CollisionGrid grid;
     glm::vec2 areaMin = glm::vec2(-1.0f, -1.0f);
     glm::vec2 areaMax = glm::vec2(1.0f, 1.0f);
     
-    Engine(int substeps) : numSubsteps(substeps) {}
+    Engine(int substeps, int solverSteps = 1) : numSubsteps(substeps), solverSteps(solverSteps) {}
 
     void constrainToArea(float minX, float maxX, float minY, float maxY, PhysicsBodyPtr body)
     {
@@ -42,59 +52,71 @@ private:
     }
 
 
+    void solveCollision(size_t i, size_t j)
+    {
+        glm::vec2 posA = bodies[i]->getPosition();
+        glm::vec2 posB = bodies[j]->getPosition();
+        float distance = glm::length(posA - posB);
+        float minDistance = bodies[i]->getRadius() + bodies[j]->getRadius();
+
+        if (distance < minDistance && distance > 0.0f)
+        {
+            glm::vec2 collisionNormal = glm::normalize(posB - posA);
+            glm::vec2 correction = collisionNormal * (minDistance - distance) * 0.5f;
+
+            bodies[i]->move(-correction);
+            bodies[j]->move(correction);
+        }
+    }
+
     void solveCollisions()
     {
+        if (broadphase == Broadphase::Grid)
+        {
+            grid.build(bodies, areaMin, areaMax);
+            grid.forEachPair([this](size_t i, size_t j) { solveCollision(i, j); });
+            return;
+        }
+
         for (size_t i = 0; i < bodies.size(); i++)
         {
             for (size_t j = i + 1; j < bodies.size(); j++)
             {
-                glm::vec2 posA = bodies[i]->getPosition();
-                glm::vec2 posB = bodies[j]->getPosition();
-                float distance = glm::length(posA - posB);
-                float minDistance = bodies[i]->getRadius() + bodies[j]->getRadius();
-
-                if (distance < minDistance && distance > 0.0f)
-                {
-                    glm::vec2 collisionNormal = glm::normalize(posB - posA);
-                    glm::vec2 correction = collisionNormal * (minDistance - distance) * 0.5f;
-
-                    bodies[i]->move(-correction);
-                    bodies[j]->move(correction);
-                }
+                solveCollision(i, j);
             }
         }
     }
 public:
     
-    static EnginePtr make(int substeps = 5)
+    static EnginePtr make(int substeps = 5, int solverSteps = 1)
     {
-        return EnginePtr (new Engine(substeps));
+        return EnginePtr (new Engine(substeps, solverSteps));
     }
 
-    static EnginePtr make(float gravityX, float gravityY, int substeps = 5)
+    static EnginePtr make(float gravityX, float gravityY, int substeps = 5, int solverSteps = 1)
     {
-        EnginePtr engine = Engine::make(substeps);
+        EnginePtr engine = Engine::make(substeps, solverSteps);
         engine->setGravity(glm::vec2(gravityX, gravityY));
         return engine;
     }
 
-    static EnginePtr make(glm::vec2 gravity, int substeps = 5)
+    static EnginePtr make(glm::vec2 gravity, int substeps = 5, int solverSteps = 1)
     {
-        EnginePtr engine = Engine::make(substeps);
+        EnginePtr engine = Engine::make(substeps, solverSteps);
         engine->setGravity(gravity);
         return engine;
     }
 
-    static EnginePtr make(glm::vec2 minArea, glm::vec2 maxArea, glm::vec2 gravity = glm::vec2(0.0f, -9.81f), int substeps = 5)
+    static EnginePtr make(glm::vec2 minArea, glm::vec2 maxArea, glm::vec2 gravity = glm::vec2(0.0f, -9.81f), int substeps = 5, int solverSteps = 1)
     {
-        EnginePtr engine = Engine::make(substeps);
+        EnginePtr engine = Engine::make(substeps, solverSteps);
         engine->setArea(minArea, maxArea);
         engine->setGravity(gravity);
         return engine;
     }
-    static EnginePtr make(float minX, float maxX, float minY, float maxY, glm::vec2 gravity = glm::vec2(0.0f, -9.81f), int substeps = 5)
+    static EnginePtr make(float minX, float maxX, float minY, float maxY, glm::vec2 gravity = glm::vec2(0.0f, -9.81f), int substeps = 5, int solverSteps = 1)
     {
-        EnginePtr engine = Engine::make(substeps);
+        EnginePtr engine = Engine::make(substeps, solverSteps);
         engine->setArea(minX, maxX, minY, maxY);
         engine->setGravity(gravity);
         return engine;
@@ -108,13 +130,38 @@ public:
             for (auto &body : bodies)
             {
                 body->accelerate(gravity);
-                constrainToArea(areaMin.x,areaMax.x,areaMin.y,areaMax.y, body); // Constrain within a default area
-                solveCollisions();
                 body->calculateNextPosition(substepDelta);
             }
+            for (int k = 0; k < solverSteps; k++) {
+                solveCollisions();
+                for (auto &body : bodies)
+                {
+                    constrainToArea(areaMin.x, areaMax.x, areaMin.y, areaMax.y, body);
+                }
+            }
+        }
+        syncTransforms();
+    }
+
+    // Write-back da física para o grafo de cena: um setTranslate por corpo que se moveu.
+    void syncTransforms()
+    {
+        for (auto &body : bodies)
+        {
+            body->update();
         }
     }
 
+    void setBroadphase(Broadphase mode)
+    {
+        broadphase = mode;
+    }
+
+    Broadphase getBroadphase() const
+    {
+        return broadphase;
+    }
+
     void multiplyGravity(float factor)
     {
         gravity *= factor;
@@ -146,4 +193,4 @@ public:
         areaMin = min;
         areaMax = max;
     }
-};
\ No newline at end of file
+};
\ No newline at end of file
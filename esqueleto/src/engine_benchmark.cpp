@@ -0,0 +1,76 @@
+// Benchmark de escala da engine de física, roda sem janela nem contexto OpenGL.
+// Uso: EngineBenchmark [passos] [--brute-all]
+#include "engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+static double runScene(int bodyCount, int steps, Broadphase broadphase)
+{
+    EnginePtr engine = Engine::make(-1.0f, 1.0f, -1.0f, 1.0f, glm::vec2(0.0f, -9.81f), 5, 1);
+    engine->setBroadphase(broadphase);
+
+    // Radius shrinks with the body count so every scene fills a similar fraction of the area.
+    float radius = 0.4f / std::sqrt(static_cast<float>(bodyCount));
+    std::mt19937 gen(1761);
+    std::uniform_real_distribution<float> distr(-1.0f + radius, 1.0f - radius);
+    for (int i = 0; i < bodyCount; i++)
+    {
+        engine->addBody(PhysicsBody::Make(glm::vec2(distr(gen), distr(gen)), nullptr, radius));
+    }
+
+    const float dt = 1.0f / 60.0f;
+    engine->update(dt); // warm-up
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+    {
+        engine->update(dt);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / steps;
+}
+
+int main(int argc, char **argv)
+{
+    int steps = 60;
+    bool bruteAll = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--brute-all") == 0)
+            bruteAll = true;
+        else
+            steps = std::max(1, std::atoi(argv[i]));
+    }
+
+    const int sizes[] = {100, 1000, 10000};
+
+    std::cout << std::left << std::setw(12) << "bodies"
+              << std::setw(14) << "broadphase"
+              << std::setw(14) << "ms/step"
+              << "ns/body/step" << std::endl;
+
+    for (int n : sizes)
+    {
+        for (Broadphase mode : {Broadphase::Grid, Broadphase::BruteForce})
+        {
+            // O(n^2) at 10k bodies takes minutes, only run it on request.
+            if (mode == Broadphase::BruteForce && n > 1000 && !bruteAll)
+                continue;
+
+            double ms = runScene(n, steps, mode);
+            std::cout << std::left << std::setw(12) << n
+                      << std::setw(14) << (mode == Broadphase::Grid ? "grid" : "brute-force")
+                      << std::setw(14) << std::fixed << std::setprecision(3) << ms
+                      << std::setprecision(1) << ms * 1.0e6 / n << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -21,16 +21,45 @@ using NodePtr = std::shared_ptr<Node>;
 
 using ParentPtr = std::weak_ptr<Node>; // ponteiro fraco para evitar ciclos de referência
 
+// Entrada da travessia achatada: o nó e o índice logo depois da sua subárvore,
+// para pular a subárvore inteira de uma vez.
+struct DrawEntry {
+    Node* node;
+    int end;
+};
+
 class Node : public std::enable_shared_from_this<Node>{ // BACALHAU falta fazer as subclasses de nó
 private:
     int id;
     inline static int next_id = 0;
+    inline static unsigned int topology_version = 0; // muda a cada alteração de filhos em qualquer nó
     std::string name;
     std::vector<NodePtr> children;
     int child_count = 0;
     ParentPtr parent; // pode ser nulo
     bool applicability = true;
     bool local_applicability = true;
+
+    // Travessia em pré-ordem da subárvore deste nó, refeita só quando a topologia muda.
+    std::vector<DrawEntry> draw_list;
+    unsigned int draw_list_version = ~0u;
+    std::vector<DrawEntry> open_entries; // nós com apply() pendente de unapply() durante o draw
+
+    static void appendToDrawList(std::vector<DrawEntry>& list, Node* node) {
+        int index = list.size();
+        list.push_back({node, 0});
+        for (const NodePtr& child : node->children) {
+            appendToDrawList(list, child.get());
+        }
+        list[index].end = list.size();
+    }
+
+    void updateDrawList() {
+        if (draw_list_version == topology_version) return;
+        draw_list.clear();
+        appendToDrawList(draw_list, this);
+        draw_list_version = topology_version;
+    }
     
     friend class scene::SceneGraph;
 
@@ -134,6 +163,7 @@ public:
 
     void addChild(NodePtr child) {
         children.push_back(child);
+        topology_version++;
         child->setParent(shared_from_this());
     }
 
@@ -143,11 +173,13 @@ public:
             return;
         }
         children.insert(children.begin() + index, child);
+        topology_version++;
         child->setParent(shared_from_this());
     }
 
     void addChildFront(NodePtr child) {
         children.insert(children.begin(), child);
+        topology_version++;
         child->setParent(shared_from_this());
     }
 
@@ -155,6 +187,7 @@ public:
         auto it = std::find(children.begin(), children.end(), after);
         if (it != children.end()) {
             children.insert(it + 1, child);
+            topology_version++;
         } else {
             std::cerr << "Reference child not found in addChildAfter" << std::endl;
         }
@@ -169,6 +202,7 @@ public:
         NodePtr child = children[from_idx];
         children.erase(children.begin() + from_idx);
         children.insert(children.begin() + to_idx, child);
+        topology_version++;
     }
 
     void swapChildren(int idx1, int idx2) {
@@ -177,6 +211,7 @@ public:
             return;
         }
         std::swap(children[idx1], children[idx2]);
+        topology_version++;
     }
 
     void removeChild(NodePtr child) {
@@ -184,6 +219,7 @@ public:
         if (it != children.end()) {
             (*it)->setParent(nullptr);
             children.erase(it);
+            topology_version++;
         } else {
             std::cerr << "Child not found in removeChild" << std::endl;
         }
@@ -193,24 +229,41 @@ public:
 
     virtual void unapply() {}
 
+    // Percorre a lista achatada em vez de recursão nos filhos: sem cópias de
+    // shared_ptr por nó, e subárvores desligadas são puladas pelo índice end.
     void draw(bool print = false) {
-        if (!applicability) return;
-        if (print) printf("Drawing node %s (id=%d) (parent=%s)\n", name.c_str(), id, parent.lock()? parent.lock()->getName().c_str() : "NONE");
-
+        updateDrawList();
         Error::Check("scene::Node::draw start");
+        open_entries.clear();
+
+        const int count = draw_list.size();
+        int i = 0;
+        while (i < count) {
+            // Desfaz os nós cujas subárvores terminaram antes deste
+            while (!open_entries.empty() && open_entries.back().end <= i) {
+                open_entries.back().node->unapply();
+                open_entries.pop_back();
+            }
 
-        if (!local_applicability) apply();
-
-        Error::Check("scene::Node::draw after apply");
+            const DrawEntry& entry = draw_list[i];
+            Node* node = entry.node;
+            if (!node->applicability) {
+                i = entry.end;
+                continue;
+            }
+            i++;
+            if (print) printf("Drawing node %s (id=%d) (parent=%s)\n", node->name.c_str(), node->id, node->parent.lock()? node->parent.lock()->getName().c_str() : "NONE");
 
-        // Desenha os filhos
-        for (NodePtr child : children) {
-            child->draw(print);
+            if (!node->local_applicability) {
+                node->apply();
+                open_entries.push_back(entry);
+            }
+            Error::Check("scene::Node::draw after apply");
+        }
+        while (!open_entries.empty()) {
+            open_entries.back().node->unapply();
+            open_entries.pop_back();
         }
-        Error::Check("scene::Node::draw after drawing children");
-
-        if (!local_applicability) unapply();
-
         Error::Check("scene::Node::draw end");
     }
 };
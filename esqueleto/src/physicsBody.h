@@ -14,6 +14,7 @@ private:
     glm::vec2 acceleration;
     float radius;
     transform::TransformPtr nodeTransform;
+    bool transformDirty = true; // posição mudou desde a última escrita no transform
 
     PhysicsBody(const glm::vec2 &oldPosition, const glm::vec2 &initialPosition, transform::TransformPtr nodeTransform, float radius)
         : positionOld(oldPosition), positionCurrent(initialPosition), acceleration(0.0f, 0.0f), radius(radius), nodeTransform(nodeTransform) {}
@@ -32,6 +33,7 @@ public:
     void setNodeTransform(transform::TransformPtr t)
     {
         nodeTransform = t;
+        transformDirty = true;
     }
 
     void calculateNextPosition(float deltaTime)
@@ -40,12 +42,7 @@ public:
         positionOld = positionCurrent;
         positionCurrent += velocity + acceleration * deltaTime * deltaTime;
         acceleration = glm::vec2(0.0f, 0.0f);
-
-        // Atualiza o transform do nó, se existir
-        if (nodeTransform)
-        {
-            nodeTransform->setTranslate(positionCurrent.x, positionCurrent.y, 0.0f);
-        }
+        transformDirty = transformDirty || positionCurrent != positionOld;
     }
 
     void accelerate(const glm::vec2 &accel)
@@ -67,14 +64,20 @@ public:
     void move(const glm::vec2 &newPosition)
     {
         positionCurrent += newPosition;
-        // Atualiza o transform do nó, se existir
-        if (nodeTransform)
-        {
-            nodeTransform->setTranslate(positionCurrent.x, positionCurrent.y, 0.0f);
-        }
+        transformDirty = transformDirty || newPosition != glm::vec2(0.0f, 0.0f);
     }
     void moveOld(const glm::vec2 &newPosition)
     {
         positionOld += newPosition;
     }
+    // Escreve a posição no transform do nó, só se ela mudou desde a última escrita.
+    // Chamado uma vez por frame pela Engine, depois de todos os substeps.
+    void update()
+    {
+        if (transformDirty && nodeTransform)
+        {
+            nodeTransform->setTranslate(positionCurrent.x, positionCurrent.y, 0.0f);
+        }
+        transformDirty = false;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 410
+
+in vec2 localPos;
+in float awake;
+out vec4 fragColor;
+
+void main() {
+    // Lit sphere look, light from the top left; sleeping bodies are dimmed.
+    float d = clamp(dot(localPos, localPos), 0.0, 1.0);
+    vec3 normal = vec3(localPos, sqrt(1.0 - d));
+    float light = max(dot(normal, normalize(vec3(-0.4, 0.5, 0.8))), 0.0);
+    vec3 color = mix(vec3(0.1, 0.25, 0.55), vec3(0.35, 0.65, 1.0), light);
+    fragColor = vec4(color * mix(0.55, 1.0, awake), 1.0);
+}
@@ -0,0 +1,15 @@
+#version 410
+
+layout (location=0) in vec2 vertex;
+// center.xy, radius, awake (1) or sleeping (0)
+layout (location=1) in vec4 instance;
+
+out vec2 localPos;
+out float awake;
+
+void main (void)
+{
+  localPos = vertex;
+  awake = instance.w;
+  gl_Position = vec4(instance.xy + vertex * instance.z, 0.5, 1.0);
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <gl_base/transform.h>
+
+class BodyStore;
+using BodyStorePtr = std::shared_ptr<BodyStore>;
+
+// Structure-of-arrays storage for the Verlet bodies. The Engine iterates
+// these arrays directly; PhysicsBody is only a handle (store + index) into them.
+class BodyStore
+{
+public:
+    std::vector<float> x, y;
+    std::vector<float> oldX, oldY;
+    std::vector<float> ax, ay;
+    std::vector<float> r;
+    std::vector<float> awake;      // 1.0 awake, 0.0 sleeping; used as a mask by the integrator
+    std::vector<int> stillFrames;  // consecutive frames spent below the sleep speed
+    // Material: 1/mass (1 by default), bounciness and Coulomb friction (0 by default).
+    std::vector<float> invMass;
+    std::vector<float> restitution;
+    std::vector<float> friction;
+    // Positions at the start of the last Engine::update, used for render interpolation.
+    std::vector<float> prevX, prevY;
+    std::vector<transform::TransformPtr> transforms;
+    // Position last written to each transform; NaN forces the next write.
+    std::vector<float> syncedX, syncedY;
+
+    static BodyStorePtr Make()
+    {
+        return BodyStorePtr(new BodyStore());
+    }
+
+    size_t size() const
+    {
+        return x.size();
+    }
+
+    size_t add(const glm::vec2 &oldPosition, const glm::vec2 &position, const glm::vec2 &acceleration, float radius, transform::TransformPtr nodeTransform)
+    {
+        x.push_back(position.x);
+        y.push_back(position.y);
+        oldX.push_back(oldPosition.x);
+        oldY.push_back(oldPosition.y);
+        ax.push_back(acceleration.x);
+        ay.push_back(acceleration.y);
+        r.push_back(radius);
+        awake.push_back(1.0f);
+        stillFrames.push_back(0);
+        invMass.push_back(1.0f);
+        restitution.push_back(0.0f);
+        friction.push_back(0.0f);
+        prevX.push_back(position.x);
+        prevY.push_back(position.y);
+        transforms.push_back(nodeTransform);
+        syncedX.push_back(std::numeric_limits<float>::quiet_NaN());
+        syncedY.push_back(std::numeric_limits<float>::quiet_NaN());
+        return x.size() - 1;
+    }
+
+    void reserve(size_t count)
+    {
+        x.reserve(count);
+        y.reserve(count);
+        oldX.reserve(count);
+        oldY.reserve(count);
+        ax.reserve(count);
+        ay.reserve(count);
+        r.reserve(count);
+        awake.reserve(count);
+        stillFrames.reserve(count);
+        invMass.reserve(count);
+        restitution.reserve(count);
+        friction.reserve(count);
+        prevX.reserve(count);
+        prevY.reserve(count);
+        transforms.reserve(count);
+        syncedX.reserve(count);
+        syncedY.reserve(count);
+    }
+
+    // Writes (px, py) to the node transform of body i if it differs from the last write.
+    void syncTransform(size_t i, float px, float py)
+    {
+        if (px == syncedX[i] && py == syncedY[i])
+            return;
+        if (transforms[i])
+        {
+            transforms[i]->setTranslate(px, py, 0.0f);
+        }
+        syncedX[i] = px;
+        syncedY[i] = py;
+    }
+
+    void syncTransform(size_t i)
+    {
+        syncTransform(i, x[i], y[i]);
+    }
+
+    // Resizes every array to count bodies; new slots are zeroed, awake and without a transform.
+    void resize(size_t count)
+    {
+        x.resize(count, 0.0f);
+        y.resize(count, 0.0f);
+        oldX.resize(count, 0.0f);
+        oldY.resize(count, 0.0f);
+        ax.resize(count, 0.0f);
+        ay.resize(count, 0.0f);
+        r.resize(count, 0.0f);
+        awake.resize(count, 1.0f);
+        stillFrames.resize(count, 0);
+        invMass.resize(count, 1.0f);
+        restitution.resize(count, 0.0f);
+        friction.resize(count, 0.0f);
+        prevX.resize(count, 0.0f);
+        prevY.resize(count, 0.0f);
+        transforms.resize(count);
+        syncedX.assign(count, std::numeric_limits<float>::quiet_NaN());
+        syncedY.assign(count, std::numeric_limits<float>::quiet_NaN());
+    }
+
+    // Removes body i by moving the last body into its slot. Never reallocates.
+    void swapRemove(size_t i)
+    {
+        auto removeFrom = [i](auto &values) {
+            values[i] = values.back();
+            values.pop_back();
+        };
+        removeFrom(x);
+        removeFrom(y);
+        removeFrom(oldX);
+        removeFrom(oldY);
+        removeFrom(ax);
+        removeFrom(ay);
+        removeFrom(r);
+        removeFrom(awake);
+        removeFrom(stillFrames);
+        removeFrom(invMass);
+        removeFrom(restitution);
+        removeFrom(friction);
+        removeFrom(prevX);
+        removeFrom(prevY);
+        removeFrom(transforms);
+        removeFrom(syncedX);
+        removeFrom(syncedY);
+    }
+
+    void copyMaterial(size_t to, const BodyStore &from, size_t i)
+    {
+        invMass[to] = from.invMass[i];
+        restitution[to] = from.restitution[i];
+        friction[to] = from.friction[i];
+    }
+
+    void wake(size_t i)
+    {
+        awake[i] = 1.0f;
+        stillFrames[i] = 0;
+    }
+
+    void savePrevious()
+    {
+        prevX.assign(x.begin(), x.end());
+        prevY.assign(y.begin(), y.end());
+    }
+
+    void clear()
+    {
+        x.clear();
+        y.clear();
+        oldX.clear();
+        oldY.clear();
+        ax.clear();
+        ay.clear();
+        r.clear();
+        awake.clear();
+        stillFrames.clear();
+        invMass.clear();
+        restitution.clear();
+        friction.clear();
+        prevX.clear();
+        prevY.clear();
+        transforms.clear();
+        syncedX.clear();
+        syncedY.clear();
+    }
+};
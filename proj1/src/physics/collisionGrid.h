@@ -0,0 +1,211 @@
+#pragma once
+#include "bodyStore.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Uniform grid used as the broadphase of Engine::solveCollisions.
+// The cell size is the largest body diameter, so two overlapping circles
+// always fall in the same or in neighbouring cells.
+class CollisionGrid
+{
+private:
+    glm::vec2 origin = glm::vec2(0.0f, 0.0f);
+    float cellSize = 1.0f;
+    int cols = 1;
+    int rows = 1;
+    std::vector<int> cellStart;  // cols * rows + 1 offsets into cellBodies
+    std::vector<int> cellBodies; // body indices, grouped by cell
+    std::vector<int> bodyCell;
+    std::vector<int> cellFill;
+    std::vector<int> candidates;
+
+    int cellCoord(float value, float start, int count) const
+    {
+        int c = static_cast<int>(std::floor((value - start) / cellSize));
+        return std::clamp(c, 0, count - 1);
+    }
+
+public:
+    void build(const BodyStore &bodies, glm::vec2 areaMin, glm::vec2 areaMax)
+    {
+        float maxRadius = 0.0f;
+        glm::vec2 lo(FLT_MAX, FLT_MAX);
+        glm::vec2 hi(-FLT_MAX, -FLT_MAX);
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            glm::vec2 pos(bodies.x[i], bodies.y[i]);
+            maxRadius = std::max(maxRadius, bodies.r[i]);
+            lo = glm::min(lo, pos);
+            hi = glm::max(hi, pos);
+        }
+
+        // Bodies are kept inside the area, so the grid only spans the occupied part of it.
+        // Anything outside is clamped to the border cells, which keeps neighbours adjacent.
+        lo = glm::clamp(lo, areaMin, areaMax);
+        hi = glm::clamp(hi, lo, areaMax);
+
+        cellSize = std::max(2.0f * maxRadius, 1e-4f);
+        // Very tall areas (proj1 uses maxY = 1000) or tiny radii would produce
+        // far more cells than bodies; coarser cells stay correct, just less selective.
+        const double maxCells = 4.0 * static_cast<double>(bodies.size()) + 16.0;
+        while ((std::floor((hi.x - lo.x) / cellSize) + 1.0) * (std::floor((hi.y - lo.y) / cellSize) + 1.0) > maxCells)
+        {
+            cellSize *= 2.0f;
+        }
+        origin = lo;
+        cols = static_cast<int>(std::floor((hi.x - lo.x) / cellSize)) + 1;
+        rows = static_cast<int>(std::floor((hi.y - lo.y) / cellSize)) + 1;
+
+        // Counting sort of the bodies by cell.
+        cellStart.assign(static_cast<size_t>(cols) * rows + 1, 0);
+        bodyCell.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            int cell = cellCoord(bodies.y[i], origin.y, rows) * cols + cellCoord(bodies.x[i], origin.x, cols);
+            bodyCell[i] = cell;
+            cellStart[cell + 1]++;
+        }
+        for (size_t c = 1; c < cellStart.size(); c++)
+        {
+            cellStart[c] += cellStart[c - 1];
+        }
+        cellBodies.resize(bodies.size());
+        cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            cellBodies[cellFill[bodyCell[i]]++] = static_cast<int>(i);
+        }
+    }
+
+    // Calls solve(i, j) for every candidate pair with i < j, in the same order
+    // as the brute-force double loop. Both paths give identical results unless a
+    // correction carries a body further than a cell during the pass.
+    template <typename Solve>
+    void forEachPair(Solve solve)
+    {
+        for (size_t i = 0; i < bodyCell.size(); i++)
+        {
+            int cx = bodyCell[i] % cols;
+            int cy = bodyCell[i] / cols;
+
+            candidates.clear();
+            for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, rows - 1); y++)
+            {
+                for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, cols - 1); x++)
+                {
+                    int cell = y * cols + x;
+                    for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+                    {
+                        if (cellBodies[k] > static_cast<int>(i))
+                            candidates.push_back(cellBodies[k]);
+                    }
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            for (int j : candidates)
+            {
+                solve(i, static_cast<size_t>(j));
+            }
+        }
+    }
+
+    int getColumnCount() const
+    {
+        return cols;
+    }
+
+    // Number of bodies in the last build.
+    size_t size() const
+    {
+        return bodyCell.size();
+    }
+
+    // Calls visit(k) for every other body in the 3x3 cells around body i.
+    template <typename Visit>
+    void forEachNeighbour(size_t i, Visit visit) const
+    {
+        int cx = bodyCell[i] % cols;
+        int cy = bodyCell[i] / cols;
+        for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, rows - 1); y++)
+        {
+            for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, cols - 1); x++)
+            {
+                int cell = y * cols + x;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+                {
+                    if (cellBodies[k] != static_cast<int>(i))
+                        visit(static_cast<size_t>(cellBodies[k]));
+                }
+            }
+        }
+    }
+
+    float getCellSize() const
+    {
+        return cellSize;
+    }
+
+    // Calls visit(k) for every body whose cell overlaps [lo, hi]. Bodies reach at
+    // most half a cell out of their own, so grow the box by that for overlap tests.
+    template <typename Visit>
+    void forEachInBox(glm::vec2 lo, glm::vec2 hi, Visit visit) const
+    {
+        int x0 = cellCoord(lo.x, origin.x, cols);
+        int x1 = cellCoord(hi.x, origin.x, cols);
+        int y0 = cellCoord(lo.y, origin.y, rows);
+        int y1 = cellCoord(hi.y, origin.y, rows);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                int cell = y * cols + x;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+                {
+                    visit(static_cast<size_t>(cellBodies[k]));
+                }
+            }
+        }
+    }
+
+    // Half-stencil walk over the cells in columns [colBegin, colEnd): a pair is
+    // visited once, from its left cell (or lower cell, inside one column).
+    // Only bodies in columns [colBegin, colEnd] are touched, so column ranges
+    // that are at least one column apart can be solved at the same time.
+    template <typename Solve>
+    void forEachPairInColumns(int colBegin, int colEnd, Solve solve) const
+    {
+        static const int offsets[4][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};
+
+        for (int cx = colBegin; cx < colEnd; cx++)
+        {
+            for (int cy = 0; cy < rows; cy++)
+            {
+                int cell = cy * cols + cx;
+                for (int a = cellStart[cell]; a < cellStart[cell + 1]; a++)
+                {
+                    size_t i = static_cast<size_t>(cellBodies[a]);
+                    for (int b = a + 1; b < cellStart[cell + 1]; b++)
+                    {
+                        solve(i, static_cast<size_t>(cellBodies[b]));
+                    }
+                    for (const auto &offset : offsets)
+                    {
+                        int nx = cx + offset[0];
+                        int ny = cy + offset[1];
+                        if (nx >= cols || ny < 0 || ny >= rows)
+                            continue;
+                        int neighbour = ny * cols + nx;
+                        for (int b = cellStart[neighbour]; b < cellStart[neighbour + 1]; b++)
+                        {
+                            solve(i, static_cast<size_t>(cellBodies[b]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,276 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ConstraintSet;
+using ConstraintSetPtr = std::shared_ptr<ConstraintSet>;
+
+// Position constraints between bodies of one BodyStore, referenced by index.
+// Every kind is kept as parallel arrays. Links are sorted into batches where
+// no two links share a body, so a batch can be solved in any order (or
+// concurrently) with the same result. The Engine does the actual solving.
+class ConstraintSet
+{
+private:
+    static const int MAX_COLORS = 64;
+
+    bool dirty = false;
+
+    ConstraintSet() {}
+
+    template <typename Values>
+    static void permute(Values &values, const std::vector<size_t> &order)
+    {
+        Values sorted(values.size());
+        for (size_t k = 0; k < order.size(); k++)
+            sorted[k] = values[order[k]];
+        values.swap(sorted);
+    }
+
+    template <typename Keep>
+    void filterLinks(Keep &&keep)
+    {
+        size_t out = 0;
+        for (size_t k = 0; k < linkA.size(); k++)
+        {
+            if (!keep(linkA[k], linkB[k]))
+                continue;
+            linkA[out] = linkA[k];
+            linkB[out] = linkB[k];
+            linkRest[out] = linkRest[k];
+            linkStiffness[out] = linkStiffness[k];
+            out++;
+        }
+        linkA.resize(out);
+        linkB.resize(out);
+        linkRest.resize(out);
+        linkStiffness.resize(out);
+    }
+
+    template <typename Keep>
+    void filterPins(Keep &&keep)
+    {
+        size_t out = 0;
+        for (size_t k = 0; k < pinBody.size(); k++)
+        {
+            if (!keep(pinBody[k]))
+                continue;
+            pinBody[out] = pinBody[k];
+            pinX[out] = pinX[k];
+            pinY[out] = pinY[k];
+            out++;
+        }
+        pinBody.resize(out);
+        pinX.resize(out);
+        pinY.resize(out);
+    }
+
+    template <typename Keep>
+    void filterAngles(Keep &&keep)
+    {
+        size_t out = 0;
+        for (size_t k = 0; k < angleA.size(); k++)
+        {
+            if (!keep(angleA[k], angleCenter[k], angleC[k]))
+                continue;
+            angleA[out] = angleA[k];
+            angleCenter[out] = angleCenter[k];
+            angleC[out] = angleC[k];
+            angleMin[out] = angleMin[k];
+            angleMax[out] = angleMax[k];
+            out++;
+        }
+        angleA.resize(out);
+        angleCenter.resize(out);
+        angleC.resize(out);
+        angleMin.resize(out);
+        angleMax.resize(out);
+    }
+
+public:
+    // Distance links: keep |a - b| at rest, corrected by stiffness (0..1) per iteration.
+    std::vector<uint32_t> linkA, linkB;
+    std::vector<float> linkRest, linkStiffness;
+    // Links of batch k are [batchStart[k], batchStart[k + 1]).
+    std::vector<size_t> batchStart;
+
+    // Pins hold a body at a world position.
+    std::vector<uint32_t> pinBody;
+    std::vector<float> pinX, pinY;
+    std::vector<uint8_t> pinned; // per body, filled by prepare
+
+    // Angle limits on the corner a-center-c, in radians within [0, pi].
+    std::vector<uint32_t> angleA, angleCenter, angleC;
+    std::vector<float> angleMin, angleMax;
+
+    static ConstraintSetPtr Make()
+    {
+        return ConstraintSetPtr(new ConstraintSet());
+    }
+
+    void addLink(uint32_t a, uint32_t b, float restLength, float stiffness)
+    {
+        linkA.push_back(a);
+        linkB.push_back(b);
+        linkRest.push_back(restLength);
+        linkStiffness.push_back(stiffness);
+        dirty = true;
+    }
+
+    // Pins body, or moves its pin if it already has one.
+    void setPin(uint32_t body, float x, float y)
+    {
+        for (size_t k = 0; k < pinBody.size(); k++)
+        {
+            if (pinBody[k] == body)
+            {
+                pinX[k] = x;
+                pinY[k] = y;
+                return;
+            }
+        }
+        pinBody.push_back(body);
+        pinX.push_back(x);
+        pinY.push_back(y);
+        dirty = true;
+    }
+
+    void removePin(uint32_t body)
+    {
+        filterPins([body](uint32_t p) { return p != body; });
+        dirty = true;
+    }
+
+    void addAngleLimit(uint32_t a, uint32_t center, uint32_t c, float minAngle, float maxAngle)
+    {
+        angleA.push_back(a);
+        angleCenter.push_back(center);
+        angleC.push_back(c);
+        angleMin.push_back(minAngle);
+        angleMax.push_back(maxAngle);
+    }
+
+    size_t getLinkCount() const
+    {
+        return linkA.size();
+    }
+
+    bool empty() const
+    {
+        return linkA.empty() && pinBody.empty() && angleA.empty();
+    }
+
+    // Keeps the indices in step with BodyStore::swapRemove(removed): constraints
+    // on the removed body go away and the body moved from last takes its index.
+    void removeBody(uint32_t removed, uint32_t last)
+    {
+        filterLinks([removed](uint32_t a, uint32_t b) { return a != removed && b != removed; });
+        filterPins([removed](uint32_t p) { return p != removed; });
+        filterAngles([removed](uint32_t a, uint32_t b, uint32_t c) { return a != removed && b != removed && c != removed; });
+        auto rename = [removed, last](std::vector<uint32_t> &indices) {
+            for (auto &index : indices)
+                if (index == last) index = removed;
+        };
+        rename(linkA);
+        rename(linkB);
+        rename(pinBody);
+        rename(angleA);
+        rename(angleCenter);
+        rename(angleC);
+        dirty = true;
+    }
+
+    void invalidate()
+    {
+        dirty = true;
+    }
+
+    void clear()
+    {
+        linkA.clear();
+        linkB.clear();
+        linkRest.clear();
+        linkStiffness.clear();
+        batchStart.clear();
+        pinBody.clear();
+        pinX.clear();
+        pinY.clear();
+        pinned.clear();
+        angleA.clear();
+        angleCenter.clear();
+        angleC.clear();
+        angleMin.clear();
+        angleMax.clear();
+        dirty = false;
+    }
+
+    // Drops constraints on bodies past bodyCount and regroups the links into
+    // batches by greedy colouring. Only does work after the set changed.
+    void prepare(size_t bodyCount)
+    {
+        if (!dirty && pinned.size() == bodyCount)
+            return;
+
+        auto valid = [bodyCount](uint32_t index) { return index < bodyCount; };
+        filterLinks([&](uint32_t a, uint32_t b) { return valid(a) && valid(b); });
+        filterPins(valid);
+        filterAngles([&](uint32_t a, uint32_t b, uint32_t c) { return valid(a) && valid(b) && valid(c); });
+
+        pinned.assign(bodyCount, 0);
+        for (uint32_t body : pinBody)
+            pinned[body] = 1;
+
+        // Colour = first batch free at both ends; links past MAX_COLORS share the last batch,
+        // which the Engine always solves serially.
+        std::vector<uint64_t> used(bodyCount, 0);
+        std::vector<int> color(linkA.size());
+        std::vector<size_t> counts(MAX_COLORS + 1, 0);
+        for (size_t k = 0; k < linkA.size(); k++)
+        {
+            uint64_t busy = used[linkA[k]] | used[linkB[k]];
+            int c = 0;
+            while (c < MAX_COLORS && (busy & (uint64_t(1) << c)))
+                c++;
+            if (c < MAX_COLORS)
+            {
+                used[linkA[k]] |= uint64_t(1) << c;
+                used[linkB[k]] |= uint64_t(1) << c;
+            }
+            color[k] = c;
+            counts[c]++;
+        }
+
+        int batches = 0;
+        while (batches <= MAX_COLORS && counts[batches] > 0)
+            batches++;
+        if (counts[MAX_COLORS] > 0)
+            batches = MAX_COLORS + 1;
+
+        batchStart.assign(batches + 1, 0);
+        for (int c = 0; c < batches; c++)
+            batchStart[c + 1] = batchStart[c] + counts[c];
+
+        std::vector<size_t> order(linkA.size());
+        std::vector<size_t> cursor(batchStart.begin(), batchStart.end() - 1);
+        for (size_t k = 0; k < linkA.size(); k++)
+            order[cursor[color[k]]++] = k;
+        permute(linkA, order);
+        permute(linkB, order);
+        permute(linkRest, order);
+        permute(linkStiffness, order);
+        dirty = false;
+    }
+
+    size_t getBatchCount() const
+    {
+        return batchStart.empty() ? 0 : batchStart.size() - 1;
+    }
+
+    // True for the overflow batch, whose links may share bodies.
+    bool isSerialBatch(size_t batch) const
+    {
+        return batch == static_cast<size_t>(MAX_COLORS);
+    }
+};
@@ -1,10 +1,73 @@
 #pragma once
 #include "physicsBody.h"
+#include "collisionGrid.h"
+#include "integrator.h"
+#include "threadPool.h"
+#include "obstacles.h"
+#include "constraints.h"
+#include "forceFields.h"
+#include "replay.h"
+#include "profiler.h"
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
 
 class Engine;
 using EnginePtr = std::shared_ptr<Engine>;
 
+enum class Broadphase
+{
+    BruteForce, // tests every pair, kept for comparison
+    Grid
+};
+
+// Counters for the last Engine::update.
+struct EngineStats
+{
+    uint64_t pairTests = 0; // candidate pairs handed to the narrowphase
+    uint64_t contacts = 0;  // candidate pairs that were actually overlapping
+    uint64_t sweeps = 0;    // fast bodies sweep-tested this update
+    uint64_t sweepHits = 0; // of those, bodies that touched something on the way
+    float maxPenetration = 0.0f; // deepest overlap met by the narrowphase
+
+    // Counts one narrowphase test whose overlap was depth (0 if none).
+    bool count(float depth)
+    {
+        pairTests++;
+        if (depth <= 0.0f)
+            return false;
+        contacts++;
+        maxPenetration = std::max(maxPenetration, depth);
+        return true;
+    }
+
+    void merge(const EngineStats &other)
+    {
+        pairTests += other.pairTests;
+        contacts += other.contacts;
+        sweeps += other.sweeps;
+        sweepHits += other.sweepHits;
+        maxPenetration = std::max(maxPenetration, other.maxPenetration);
+    }
+};
+
+// What a budgeted Engine::update actually ran with. Level 0 is the configured
+// quality; every level above it gives up a little more to stay within budget.
+struct EngineQuality
+{
+    int level = 0;
+    int substeps = 1;
+    int solverSteps = 1;
+    int sleepInterval = 1;  // sleep candidates are checked every this many updates
+    double updateMs = 0.0;  // duration of the last update
+    float budgetMs = 0.0f;  // 0 when not budgeted
+};
+
 class Engine
 {
 private:
@@ -14,62 +77,767 @@ private:
     int numSubsteps;
     int solverSteps;
     bool rigid;
+    bool interpolate = false;
+    bool sleeping = false;
+    float sleepSpeed = 0.05f;
+    int sleepFrames = 30;
+    float wakeStepSq = 0.0f; // (sleepSpeed * substep dt)^2, squared Verlet displacement threshold
+    std::vector<unsigned char> asleepAtStart;
+    std::vector<size_t> wakeQueue;
     std::vector<PhysicsBodyPtr> bodies;
+    std::vector<PhysicsBodyPtr> pool; // parked handles reused by spawnBody
+    BodyStorePtr store = BodyStore::Make();
+    Broadphase broadphase = Broadphase::Grid;
+    CollisionGrid grid;
+    uint64_t bodiesGeneration = 0; // bumped whenever bodies are added, removed or replaced
+    uint64_t gridGeneration = UINT64_MAX; // bodiesGeneration the grid was built for
+    integrator::Kind integratorKind = integrator::detect();
+    integrator::Kernel integrateKernel = integrator::select(integratorKind);
+    std::unique_ptr<ThreadPool> solverPool;
+    EngineStats stats;
+    std::vector<EngineStats> sliceStats; // per column slice, merged after a parallel pass
+    profiler::Times profile;
+    ObstacleSetPtr obstacles = ObstacleSet::Make();
+    ConstraintSetPtr constraints = ConstraintSet::Make();
+    ForceFieldSetPtr fields = ForceFieldSet::Make();
+    float budgetMs = 0.0f;
+    int qualityLevel = 0;
+    int calmUpdates = 0;    // consecutive updates well under budget
+    uint64_t updateCount = 0;
+    EngineQuality quality;
+    bool continuous = false;
+    float sweepFraction = 0.5f;
+    std::vector<uint32_t> fastBodies;
+    std::vector<uint32_t> sweepCandidates;
+    ReplayLogPtr recording;
+    // Body materials as last logged, to record changes made through handles
+    std::vector<float> recordedInvMass, recordedRestitution, recordedFriction;
+
+    static constexpr uint32_t SNAPSHOT_MAGIC = 0x534e5056; // "VPNS"
+    static constexpr uint32_t SNAPSHOT_VERSION = 4;
+    static constexpr size_t SNAPSHOT_ARRAYS = 14; // float-sized per-body arrays in a snapshot
+    static_assert(sizeof(int) == sizeof(float), "stillFrames is stored as a float-sized array");
+
+    struct SnapshotHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t count;
+        float gravity[2];
+        float areaMin[2];
+        float areaMax[2];
+        int32_t numSubsteps;
+        int32_t solverSteps;
+        float sleepSpeed;
+        int32_t sleepFrames;
+        uint8_t rigid;
+        uint8_t sleeping;
+        uint8_t interpolate;
+        uint8_t continuous;
+        uint8_t broadphase;
+        uint8_t padding[3];
+        float sweepFraction;
+        float budgetMs;
+        uint64_t updateCount; // phase of the spread-out sleep checks
+    };
     
     Engine(int substeps, int solverSteps = 1, bool rigid = true) : numSubsteps(substeps), solverSteps(solverSteps), rigid(rigid) {}
 
-    void constrainToArea(float minX, float maxX, float minY, float maxY, PhysicsBodyPtr body)
+    void moveBody(size_t i, float dx, float dy)
+    {
+        BodyStore &s = *store;
+        s.x[i] += dx;
+        s.y[i] += dy;
+        if (!rigid)
+        {
+            s.oldX[i] += dx;
+            s.oldY[i] += dy;
+        }
+    }
+
+    // Changes the velocity of body i (its motion over the last substep) by dv.
+    void addVelocity(size_t i, float dvx, float dvy)
+    {
+        BodyStore &s = *store;
+        s.oldX[i] -= dvx;
+        s.oldY[i] -= dvy;
+    }
+
+    // Velocity change that gives a contact its restitution and friction.
+    // velocity is the relative velocity left after the position correction,
+    // approach the normal speed before it (negative while closing). Friction
+    // can remove at most friction times the normal change from the sliding.
+    static glm::vec2 materialResponse(glm::vec2 velocity, glm::vec2 normal, float approach, float restitution, float friction)
+    {
+        float normalSpeed = glm::dot(velocity, normal);
+        glm::vec2 change = normal * (-restitution * approach - normalSpeed);
+        glm::vec2 tangent = velocity - normal * normalSpeed;
+        float slide = glm::length(tangent);
+        if (slide > 0.0f)
+            change = change - tangent * (std::min(slide, -friction * (1.0f + restitution) * approach) / slide);
+        return change;
+    }
+
+    void integrate(float deltaTime)
+    {
+        PHYSICS_PROFILE_SCOPE(profile, Integrate);
+        BodyStore &s = *store;
+        integrator::Arrays arrays = {
+            s.x.data(), s.y.data(), s.oldX.data(), s.oldY.data(), s.ax.data(), s.ay.data(),
+            sleeping ? s.awake.data() : nullptr, s.size()};
+        integrateKernel(arrays, gravity.x, gravity.y, deltaTime);
+    }
+
+    void constrainToArea(float minX, float maxX, float minY, float maxY)
+    {
+        BodyStore &s = *store;
+        const size_t count = s.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (sleeping && s.awake[i] == 0.0f)
+                continue;
+
+            float radius = s.r[i];
+            glm::vec2 correction(0.0f, 0.0f);
+
+            if (s.x[i] - radius < minX)
+            {
+                correction.x = (minX + radius) - s.x[i];
+            }
+            else if (s.x[i] + radius > maxX)
+            {
+                correction.x = (maxX - radius) - s.x[i];
+            }
+            if (s.y[i] - radius < minY)
+            {
+                correction.y = (minY + radius) - s.y[i];
+            }
+            else if (s.y[i] + radius > maxY)
+            {
+                correction.y = (maxY - radius) - s.y[i];
+            }
+            moveBody(i, correction.x, correction.y);
+        }
+    }
+
+    // Pushes body i out of every obstacle it overlaps.
+    bool solveObstacleContacts(size_t i)
+    {
+        BodyStore &s = *store;
+        float radius = s.r[i];
+        glm::vec2 boundsMin(s.x[i] - radius, s.y[i] - radius);
+        glm::vec2 boundsMax(s.x[i] + radius, s.y[i] + radius);
+        bool touched = false;
+        obstacles->query(boundsMin, boundsMax, [&](size_t id) {
+            glm::vec2 push(0.0f, 0.0f);
+            bool overlapping = obstacles->resolve(id, glm::vec2(s.x[i], s.y[i]), radius, push);
+            float depth = overlapping ? glm::length(push) : 0.0f;
+            if (stats.count(depth))
+            {
+                glm::vec2 normal = push / depth;
+                glm::vec2 velocity(s.x[i] - s.oldX[i], s.y[i] - s.oldY[i]);
+                float approach = glm::dot(velocity, normal);
+                moveBody(i, push.x, push.y);
+                touched = true;
+                if (approach < 0.0f && (s.restitution[i] > 0.0f || s.friction[i] > 0.0f))
+                {
+                    velocity = glm::vec2(s.x[i] - s.oldX[i], s.y[i] - s.oldY[i]);
+                    glm::vec2 change = materialResponse(velocity, normal, approach, s.restitution[i], s.friction[i]);
+                    addVelocity(i, change.x, change.y);
+                }
+            }
+        });
+        return touched;
+    }
+
+    // Rebuilds the grid from the current positions, for the current set of bodies.
+    void buildGrid()
+    {
+        grid.build(*store, areaMin, areaMax);
+        gridGeneration = bodiesGeneration;
+    }
+
+    // The grid indexes bodies by position in the store, so it is only usable
+    // while the set of bodies is the one it was built for.
+    bool gridIsCurrent() const
+    {
+        return gridGeneration == bodiesGeneration;
+    }
+
+    // Bodies that moved more than sweepFraction of their radius in the last
+    // substep are walked again from their old position in radius-sized steps,
+    // solving contacts with the bodies and obstacles along the way. Only those
+    // bodies get the extra steps, so a small fast circle cannot jump over a
+    // neighbour or a thin segment while the rest of the scene is untouched.
+    void sweepFastBodies()
+    {
+        static const int MAX_SWEEP_STEPS = 32;
+
+        BodyStore &s = *store;
+        const size_t count = s.size();
+        {
+            PHYSICS_PROFILE_SCOPE(profile, Narrowphase);
+            fastBodies.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                // A point body has no size to step by; the discrete pass handles it.
+                if ((sleeping && s.awake[i] == 0.0f) || s.r[i] <= 0.0f)
+                    continue;
+                float limit = s.r[i] * sweepFraction;
+                if (speedSq(i) > limit * limit)
+                    fastBodies.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        if (fastBodies.empty())
+            return;
+
+        if (broadphase == Broadphase::Grid)
+        {
+            PHYSICS_PROFILE_SCOPE(profile, Broadphase);
+            buildGrid();
+        }
+
+        PHYSICS_PROFILE_SCOPE(profile, Narrowphase);
+
+        for (uint32_t i : fastBodies)
+        {
+            stats.sweeps++;
+            glm::vec2 start(s.oldX[i], s.oldY[i]);
+            glm::vec2 travel = glm::vec2(s.x[i], s.y[i]) - start;
+            float radius = s.r[i];
+
+            sweepCandidates.clear();
+            if (broadphase == Broadphase::Grid)
+            {
+                float reach = radius + grid.getCellSize();
+                glm::vec2 lo = glm::min(start, start + travel) - glm::vec2(reach, reach);
+                glm::vec2 hi = glm::max(start, start + travel) + glm::vec2(reach, reach);
+                grid.forEachInBox(lo, hi, [&](size_t j) {
+                    if (j != i) sweepCandidates.push_back(static_cast<uint32_t>(j));
+                });
+            }
+            else
+            {
+                for (size_t j = 0; j < count; j++)
+                    if (j != i) sweepCandidates.push_back(static_cast<uint32_t>(j));
+            }
+
+            // Clamped as a float, so a huge travel never overflows the int cast
+            float span = std::min(static_cast<float>(MAX_SWEEP_STEPS), std::ceil(glm::length(travel) / radius));
+            int steps = std::max(1, static_cast<int>(span));
+            glm::vec2 step = travel / static_cast<float>(steps);
+            s.x[i] = start.x;
+            s.y[i] = start.y;
+            bool hit = false;
+            for (int k = 0; k < steps; k++)
+            {
+                s.x[i] += step.x;
+                s.y[i] += step.y;
+                for (uint32_t j : sweepCandidates)
+                {
+                    if (stats.count(solveCollision(i, j)))
+                        hit = true;
+                }
+                if (!obstacles->empty() && solveObstacleContacts(i))
+                    hit = true;
+            }
+            if (hit)
+                stats.sweepHits++;
+        }
+    }
+
+    // Adds every force field's pull to the bodies it covers. Each field only
+    // visits the grid cells under its bounds; the grid from the previous
+    // solver pass is reused unless bodies were added or removed after it was
+    // built. The slack is one cell plus the longest move of the last substep,
+    // so fast bodies that left their cell since are still visited.
+    void applyForceFields(float deltaTime)
+    {
+        PHYSICS_PROFILE_SCOPE(profile, Forces);
+        BodyStore &s = *store;
+        const ForceFieldSet &f = *fields;
+        const bool useGrid = broadphase == Broadphase::Grid;
+        if (useGrid && !gridIsCurrent())
+            buildGrid();
+        float slack = 0.0f;
+        if (useGrid)
+        {
+            float maxStepSq = 0.0f;
+            for (size_t i = 0; i < s.size(); i++)
+            {
+                if (sleeping && s.awake[i] == 0.0f)
+                    continue;
+                maxStepSq = std::max(maxStepSq, speedSq(i));
+            }
+            slack = grid.getCellSize() + std::sqrt(maxStepSq);
+        }
+
+        for (size_t k = 0; k < f.size(); k++)
+        {
+            auto apply = [&](size_t i) {
+                if (sleeping && s.awake[i] == 0.0f)
+                    return;
+                glm::vec2 velocity((s.x[i] - s.oldX[i]) / deltaTime, (s.y[i] - s.oldY[i]) / deltaTime);
+                glm::vec2 accel;
+                if (f.evaluate(k, glm::vec2(s.x[i], s.y[i]), velocity, accel))
+                {
+                    s.ax[i] += accel.x;
+                    s.ay[i] += accel.y;
+                }
+            };
+            if (useGrid)
+            {
+                float reach = f.radius[k] + slack;
+                grid.forEachInBox(glm::vec2(f.x[k] - reach, f.y[k] - reach), glm::vec2(f.x[k] + reach, f.y[k] + reach), apply);
+            }
+            else
+            {
+                for (size_t i = 0; i < s.size(); i++) apply(i);
+            }
+        }
+    }
+
+    void wakeInBox(const glm::vec2 &lo, const glm::vec2 &hi)
+    {
+        if (!sleeping)
+            return;
+        BodyStore &s = *store;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            float radius = s.r[i];
+            if (s.awake[i] == 0.0f &&
+                s.x[i] + radius >= lo.x && s.x[i] - radius <= hi.x &&
+                s.y[i] + radius >= lo.y && s.y[i] - radius <= hi.y)
+            {
+                s.wake(i);
+            }
+        }
+    }
+
+    // Circles against the static/kinematic obstacles. Obstacles never move in
+    // response, so there is no obstacle-obstacle work at all.
+    void solveObstacles()
+    {
+        PHYSICS_PROFILE_SCOPE(profile, Narrowphase);
+        const BodyStore &s = *store;
+        const size_t count = s.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (sleeping && s.awake[i] == 0.0f)
+                continue;
+            solveObstacleContacts(i);
+        }
+    }
+
+    // Share of a correction each end of a constraint takes: pinned and sleeping
+    // bodies take none, unless the other end moves fast enough to wake them.
+    bool constraintWeights(uint32_t a, uint32_t b, float &weightA, float &weightB)
+    {
+        BodyStore &s = *store;
+        const ConstraintSet &c = *constraints;
+        if (sleeping)
+        {
+            bool sleepA = s.awake[a] == 0.0f;
+            bool sleepB = s.awake[b] == 0.0f;
+            if (sleepA && !sleepB && speedSq(b) > wakeStepSq) s.wake(a);
+            if (sleepB && !sleepA && speedSq(a) > wakeStepSq) s.wake(b);
+        }
+        weightA = (c.pinned[a] || (sleeping && s.awake[a] == 0.0f)) ? 0.0f : s.invMass[a];
+        weightB = (c.pinned[b] || (sleeping && s.awake[b] == 0.0f)) ? 0.0f : s.invMass[b];
+        return weightA + weightB > 0.0f;
+    }
+
+    // Moves a and b along their axis so that they end up target apart.
+    void solveDistance(uint32_t a, uint32_t b, float target, float stiffness)
+    {
+        float weightA, weightB;
+        if (!constraintWeights(a, b, weightA, weightB))
+            return;
+
+        const BodyStore &s = *store;
+        float dx = s.x[b] - s.x[a];
+        float dy = s.y[b] - s.y[a];
+        float distance = std::sqrt(dx * dx + dy * dy);
+        if (distance == 0.0f)
+            return;
+
+        float factor = (distance - target) / distance * stiffness / (weightA + weightB);
+        moveBody(a, dx * factor * weightA, dy * factor * weightA);
+        moveBody(b, -dx * factor * weightB, -dy * factor * weightB);
+    }
+
+    void solveLinks(size_t begin, size_t end)
+    {
+        const ConstraintSet &c = *constraints;
+        for (size_t k = begin; k < end; k++)
+        {
+            solveDistance(c.linkA[k], c.linkB[k], c.linkRest[k], c.linkStiffness[k]);
+        }
+    }
+
+    // An angle limit at center is a min/max distance between the outer bodies,
+    // for the current arm lengths (law of cosines).
+    void solveAngleLimit(size_t k)
     {
-        glm::vec2 pos = body->getPosition();
-        float radius = body->getRadius();
-        glm::vec2 correction(0.0f, 0.0f);
+        const ConstraintSet &c = *constraints;
+        const BodyStore &s = *store;
+        uint32_t a = c.angleA[k];
+        uint32_t b = c.angleCenter[k];
+        uint32_t d = c.angleC[k];
+        float armA = std::hypot(s.x[a] - s.x[b], s.y[a] - s.y[b]);
+        float armC = std::hypot(s.x[d] - s.x[b], s.y[d] - s.y[b]);
+        float distance = std::hypot(s.x[d] - s.x[a], s.y[d] - s.y[a]);
+        float minDistance = std::sqrt(std::max(0.0f, armA * armA + armC * armC - 2.0f * armA * armC * std::cos(c.angleMin[k])));
+        float maxDistance = std::sqrt(std::max(0.0f, armA * armA + armC * armC - 2.0f * armA * armC * std::cos(c.angleMax[k])));
+        if (distance < minDistance)
+            solveDistance(a, d, minDistance, 1.0f);
+        else if (distance > maxDistance)
+            solveDistance(a, d, maxDistance, 1.0f);
+    }
+
+    // One Gauss-Seidel pass over the constraints, batch by batch. Large batches
+    // are split across the solver pool; their links never share a body.
+    void solveConstraints()
+    {
+        PHYSICS_PROFILE_SCOPE(profile, Constraints);
+        ConstraintSet &c = *constraints;
+        c.prepare(store->size());
+
+        const size_t parallelBatch = 1024;
+        for (size_t batch = 0; batch < c.getBatchCount(); batch++)
+        {
+            size_t begin = c.batchStart[batch];
+            size_t end = c.batchStart[batch + 1];
+            if (solverPool && !c.isSerialBatch(batch) && end - begin >= parallelBatch)
+            {
+                const int chunks = solverPool->size();
+                solverPool->run(chunks, [&](int t) {
+                    solveLinks(begin + (end - begin) * t / chunks, begin + (end - begin) * (t + 1) / chunks);
+                });
+            }
+            else
+            {
+                solveLinks(begin, end);
+            }
+        }
 
-        if (pos.x - radius < minX)
+        for (size_t k = 0; k < c.angleA.size(); k++)
         {
-            correction.x = (minX + radius) - pos.x;
+            solveAngleLimit(k);
         }
-        else if (pos.x + radius > maxX)
+
+        BodyStore &s = *store;
+        for (size_t k = 0; k < c.pinBody.size(); k++)
+        {
+            s.x[c.pinBody[k]] = c.pinX[k];
+            s.y[c.pinBody[k]] = c.pinY[k];
+        }
+    }
+
+    // Index of body in this engine's store, or false (with a message) if it was never added.
+    bool ownIndex(const PhysicsBodyPtr &body, uint32_t &index) const
+    {
+        if (!body || body->store != store)
         {
-            correction.x = (maxX - radius) - pos.x;
+            std::cerr << "Constraint on a body that is not in this engine" << std::endl;
+            return false;
         }
-        if (pos.y - radius < minY)
+        index = static_cast<uint32_t>(body->index);
+        return true;
+    }
+
+    float speedSq(size_t i) const
+    {
+        float vx = store->x[i] - store->oldX[i];
+        float vy = store->y[i] - store->oldY[i];
+        return vx * vx + vy * vy;
+    }
+
+    // Contact between an awake and a sleeping body: a fast body wakes the sleeper
+    // (its island follows in updateSleep), a slow one just settles on it.
+    void resolveSleepContact(size_t i, size_t j, float &shareA, float &shareB)
+    {
+        BodyStore &s = *store;
+        bool sleepA = s.awake[i] == 0.0f;
+        bool sleepB = s.awake[j] == 0.0f;
+        if (!sleepA && !sleepB)
+            return;
+
+        size_t mover = sleepA ? j : i;
+        size_t sleeper = sleepA ? i : j;
+        if (speedSq(mover) > wakeStepSq)
         {
-            correction.y = (minY + radius) - pos.y;
+            s.wake(sleeper);
+            return;
         }
-        else if (pos.y + radius > maxY)
+        shareA = sleepA ? 0.0f : 2.0f;
+        shareB = sleepB ? 0.0f : 2.0f;
+    }
+
+    // Returns how deep the pair was overlapping, 0 if it was not. The overlap
+    // is split by inverse mass; equal masses share it half and half.
+    float solveCollision(size_t i, size_t j)
+    {
+        const BodyStore &s = *store;
+        if (sleeping && s.awake[i] == 0.0f && s.awake[j] == 0.0f)
+            return 0.0f;
+
+        glm::vec2 posA(s.x[i], s.y[i]);
+        glm::vec2 posB(s.x[j], s.y[j]);
+        float distance = glm::length(posA - posB);
+        float minDistance = s.r[i] + s.r[j];
+
+        if (distance < minDistance && distance > 0.0f)
         {
-            correction.y = (maxY - radius) - pos.y;
+            glm::vec2 collisionNormal = glm::normalize(posB - posA);
+            glm::vec2 correction = collisionNormal * (minDistance - distance) * 0.5f;
+
+            float invMassSum = s.invMass[i] + s.invMass[j];
+            if (invMassSum == 0.0f)
+                return minDistance - distance;
+            float shareA = 2.0f * s.invMass[i] / invMassSum;
+            float shareB = 2.0f * s.invMass[j] / invMassSum;
+            if (sleeping)
+                resolveSleepContact(i, j, shareA, shareB);
+
+            float restitution = std::max(s.restitution[i], s.restitution[j]);
+            float friction = std::sqrt(s.friction[i] * s.friction[j]);
+            bool material = restitution > 0.0f || friction > 0.0f;
+            float approach = 0.0f;
+            if (material)
+                approach = glm::dot(glm::vec2(s.x[j] - s.oldX[j] - s.x[i] + s.oldX[i], s.y[j] - s.oldY[j] - s.y[i] + s.oldY[i]), collisionNormal);
+
+            moveBody(i, -correction.x * shareA, -correction.y * shareA);
+            moveBody(j, correction.x * shareB, correction.y * shareB);
+
+            if (material && approach < 0.0f && shareA + shareB > 0.0f)
+            {
+                glm::vec2 velocity(s.x[j] - s.oldX[j] - s.x[i] + s.oldX[i], s.y[j] - s.oldY[j] - s.y[i] + s.oldY[i]);
+                glm::vec2 change = materialResponse(velocity, collisionNormal, approach, restitution, friction);
+                float weightA = shareA / (shareA + shareB);
+                float weightB = shareB / (shareA + shareB);
+                addVelocity(i, -change.x * weightA, -change.y * weightA);
+                addVelocity(j, change.x * weightB, change.y * weightB);
+            }
+            return minDistance - distance;
         }
-        if (rigid) body->moveRigid(correction);
-        else body->move(correction);
+        return 0.0f;
     }
 
+    // Splits the grid into 2 * threads column slices and solves the even slices
+    // concurrently, then the odd ones. Neighbouring slices never run together,
+    // so no body is written by two threads. The slicing only depends on the
+    // thread count, which makes the result deterministic for a given count.
+    void solveCollisionsParallel()
+    {
+        const int cols = grid.getColumnCount();
+        const int slices = std::min(2 * solverPool->size(), cols);
+        sliceStats.assign(slices, EngineStats());
+
+        for (int parity = 0; parity < 2; parity++)
+        {
+            std::function<void(int)> task = [&](int t) {
+                int slice = 2 * t + parity;
+                EngineStats &local = sliceStats[slice];
+                grid.forEachPairInColumns(slice * cols / slices, (slice + 1) * cols / slices, [&](size_t i, size_t j) {
+                    local.count(solveCollision(i, j));
+                });
+            };
+            solverPool->run((slices - parity + 1) / 2, task);
+        }
+        for (const EngineStats &local : sliceStats)
+        {
+            stats.merge(local);
+        }
+    }
 
     void solveCollisions()
     {
-        for (size_t i = 0; i < bodies.size(); i++)
+        auto solve = [this](size_t i, size_t j) {
+            stats.count(solveCollision(i, j));
+        };
+
+        if (broadphase == Broadphase::Grid)
         {
-            for (size_t j = i + 1; j < bodies.size(); j++)
             {
-                glm::vec2 posA = bodies[i]->getPosition();
-                glm::vec2 posB = bodies[j]->getPosition();
-                float distance = glm::length(posA - posB);
-                float minDistance = bodies[i]->getRadius() + bodies[j]->getRadius();
+                PHYSICS_PROFILE_SCOPE(profile, Broadphase);
+                buildGrid();
+            }
+            PHYSICS_PROFILE_SCOPE(profile, Narrowphase);
+            if (solverPool && grid.getColumnCount() >= 2)
+                solveCollisionsParallel();
+            else
+                grid.forEachPair(solve);
+            return;
+        }
+
+        PHYSICS_PROFILE_SCOPE(profile, Narrowphase);
+        const size_t count = store->size();
+        for (size_t i = 0; i < count; i++)
+        {
+            for (size_t j = i + 1; j < count; j++)
+            {
+                solve(i, j);
+            }
+        }
+    }
+    template <typename Visit>
+    void forEachNearby(size_t i, Visit visit)
+    {
+        if (broadphase == Broadphase::Grid && gridIsCurrent())
+        {
+            grid.forEachNeighbour(i, visit);
+            return;
+        }
+        for (size_t k = 0; k < store->size(); k++)
+        {
+            if (k != i)
+                visit(k);
+        }
+    }
 
-                if (distance < minDistance && distance > 0.0f)
+    // Runs once per update: wakes whole contact islands around bodies that were
+    // woken this frame, then puts to sleep bodies that stayed slow for sleepFrames.
+    void updateSleep()
+    {
+        PHYSICS_PROFILE_SCOPE(profile, Sleep);
+        BodyStore &s = *store;
+        const size_t count = s.size();
+
+        wakeQueue.clear();
+        for (size_t i = 0; i < count && i < asleepAtStart.size(); i++)
+        {
+            if (asleepAtStart[i] && s.awake[i] != 0.0f)
+                wakeQueue.push_back(i);
+        }
+        while (!wakeQueue.empty())
+        {
+            size_t i = wakeQueue.back();
+            wakeQueue.pop_back();
+            forEachNearby(i, [&](size_t k) {
+                if (s.awake[k] != 0.0f)
+                    return;
+                glm::vec2 delta(s.x[k] - s.x[i], s.y[k] - s.y[i]);
+                float reach = (s.r[i] + s.r[k]) * 1.05f;
+                if (glm::dot(delta, delta) <= reach * reach)
                 {
-                    glm::vec2 collisionNormal = glm::normalize(posB - posA);
-                    glm::vec2 correction = collisionNormal * (minDistance - distance) * 0.5f;
-
-                    if (rigid) bodies[i]->moveRigid(-correction);
-                    else bodies[i]->move(-correction);
-        
-                    if (rigid) bodies[j]->moveRigid(correction);
-                    else bodies[j]->move(correction);
+                    s.wake(k);
+                    wakeQueue.push_back(k);
                 }
+            });
+        }
+
+        // Under a tight budget only every interval-th body is checked per
+        // update; a check then stands for all the updates it covered.
+        const int interval = quality.sleepInterval;
+        for (size_t i = static_cast<size_t>(updateCount % interval); i < count; i += interval)
+        {
+            if (s.awake[i] == 0.0f)
+                continue;
+
+            if (speedSq(i) > wakeStepSq)
+            {
+                s.stillFrames[i] = 0;
+            }
+            else if ((s.stillFrames[i] += interval) >= sleepFrames)
+            {
+                s.awake[i] = 0.0f;
+                s.oldX[i] = s.x[i];
+                s.oldY[i] = s.y[i];
             }
         }
     }
+
+    void record(ReplayEvent::Type type, uint32_t index = 0, glm::vec2 position = glm::vec2(0.0f, 0.0f),
+                glm::vec2 oldPosition = glm::vec2(0.0f, 0.0f), float radius = 0.0f, float deltaTime = 0.0f)
+    {
+        if (recording)
+            recording->record(ReplayEvent{type, index, position.x, position.y, oldPosition.x, oldPosition.y, radius, deltaTime});
+    }
+
+    // Logs the new body i with its material, which a handle may have set before adding it.
+    void recordSpawn(size_t i)
+    {
+        if (!recording)
+            return;
+        const BodyStore &s = *store;
+        ReplayEvent event{ReplayEvent::Type::Spawn, 0, s.x[i], s.y[i], s.oldX[i], s.oldY[i], s.r[i], 0.0f};
+        event.invMass = s.invMass[i];
+        event.restitution = s.restitution[i];
+        event.friction = s.friction[i];
+        recording->record(event);
+        recordedInvMass.push_back(s.invMass[i]);
+        recordedRestitution.push_back(s.restitution[i]);
+        recordedFriction.push_back(s.friction[i]);
+    }
+
+    // Material setters live on PhysicsBody, which does not know the engine, so
+    // while recording every update compares the materials against the log.
+    void recordMaterialChanges()
+    {
+        const BodyStore &s = *store;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            if (s.invMass[i] == recordedInvMass[i] && s.restitution[i] == recordedRestitution[i] && s.friction[i] == recordedFriction[i])
+                continue;
+            ReplayEvent event{ReplayEvent::Type::Material, static_cast<uint32_t>(i), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+            event.invMass = recordedInvMass[i] = s.invMass[i];
+            event.restitution = recordedRestitution[i] = s.restitution[i];
+            event.friction = recordedFriction[i] = s.friction[i];
+            recording->record(event);
+        }
+    }
+
+    void resetRecordedMaterials()
+    {
+        recordedInvMass = store->invMass;
+        recordedRestitution = store->restitution;
+        recordedFriction = store->friction;
+    }
+
+    PhysicsBodyPtr takeHandle()
+    {
+        if (pool.empty())
+            return PhysicsBodyPtr(new PhysicsBody());
+        PhysicsBodyPtr body = std::move(pool.back());
+        pool.pop_back();
+        return body;
+    }
+
+    void parkHandle(PhysicsBodyPtr body)
+    {
+        body->store.reset();
+        pool.push_back(std::move(body));
+    }
+
+    void despawnAt(size_t i)
+    {
+        record(ReplayEvent::Type::Despawn, static_cast<uint32_t>(i));
+        if (recording)
+        {
+            auto removeFrom = [i](std::vector<float> &values) {
+                values[i] = values.back();
+                values.pop_back();
+            };
+            removeFrom(recordedInvMass);
+            removeFrom(recordedRestitution);
+            removeFrom(recordedFriction);
+        }
+        PhysicsBodyPtr body = bodies[i];
+        size_t last = bodies.size() - 1;
+        if (!constraints->empty())
+            constraints->removeBody(static_cast<uint32_t>(i), static_cast<uint32_t>(last));
+        store->swapRemove(i);
+        bodiesGeneration++;
+        if (i != last)
+        {
+            bodies[i] = std::move(bodies[last]);
+            bodies[i]->index = i;
+        }
+        bodies.pop_back();
+        parkHandle(std::move(body));
+    }
+
 public:
     
     static EnginePtr make(int substeps = 5, int solverSteps = 1)
@@ -106,58 +874,719 @@ public:
         return engine;
     }
 
-    void update(float deltaTime)
+    // Settings for a quality level: first spread the sleep checks (only when
+    // sleeping is on), then drop solver iterations, then substeps, never going
+    // below one of each.
+    EngineQuality qualityFor(int level) const
     {
-        for (int i = 0; i < numSubsteps; i++)
+        EngineQuality q;
+        q.level = level;
+        q.substeps = numSubsteps;
+        q.solverSteps = solverSteps;
+        q.budgetMs = budgetMs;
+        for (int k = 0; k < level; k++)
         {
-            float substepDelta = deltaTime / static_cast<float>(numSubsteps);
-            for (auto &body : bodies)
+            if (sleeping && q.sleepInterval < 4) q.sleepInterval *= 2;
+            else if (q.solverSteps > 1) q.solverSteps--;
+            else if (q.substeps > 1) q.substeps--;
+        }
+        return q;
+    }
+
+    int maxQualityLevel() const
+    {
+        return (sleeping ? 2 : 0) + std::max(0, solverSteps - 1) + std::max(0, numSubsteps - 1);
+    }
+
+    // Moves one level down when an update overran the budget, and back up
+    // after a second of updates that used less than half of it.
+    void adaptQuality(double elapsedMs)
+    {
+        if (budgetMs <= 0.0f)
+            return;
+        if (elapsedMs > budgetMs)
+        {
+            calmUpdates = 0;
+            qualityLevel = std::min(qualityLevel + 1, maxQualityLevel());
+        }
+        else if (elapsedMs < budgetMs * 0.5 && qualityLevel > 0)
+        {
+            if (++calmUpdates >= 60)
+            {
+                calmUpdates = 0;
+                qualityLevel--;
+            }
+        }
+        else
+        {
+            calmUpdates = 0;
+        }
+    }
+
+private:
+    // One update at the settings in quality, which is logged with the step.
+    void runUpdate(float deltaTime)
+    {
+        if (recording)
+        {
+            recordMaterialChanges();
+            ReplayEvent event{ReplayEvent::Type::Step, 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, deltaTime};
+            event.substeps = quality.substeps;
+            event.solverSteps = quality.solverSteps;
+            event.sleepInterval = quality.sleepInterval;
+            recording->record(event);
+        }
+        auto start = std::chrono::steady_clock::now();
+        stats = EngineStats();
+        profile.clear();
+        store->savePrevious();
+        if (sleeping)
+        {
+            asleepAtStart.resize(store->size());
+            for (size_t i = 0; i < store->size(); i++)
             {
-                body->accelerate(gravity);
-                body->calculateNextPosition(substepDelta);
+                asleepAtStart[i] = store->awake[i] == 0.0f;
             }
-            for (int k = 0; k < solverSteps; k++) {
+        }
+        for (int i = 0; i < quality.substeps; i++)
+        {
+            float substepDelta = deltaTime / static_cast<float>(quality.substeps);
+            wakeStepSq = sleepSpeed * substepDelta * sleepSpeed * substepDelta;
+            if (!fields->empty())
+                applyForceFields(substepDelta);
+            integrate(substepDelta);
+            if (continuous)
+                sweepFastBodies();
+            for (int k = 0; k < quality.solverSteps; k++) {
                 solveCollisions();
-                for (auto &body : bodies)
-                {
-                    constrainToArea(areaMin.x, areaMax.x, areaMin.y, areaMax.y, body);
-                }
+                if (!obstacles->empty())
+                    solveObstacles();
+                if (!constraints->empty())
+                    solveConstraints();
+                constrainToArea(areaMin.x, areaMax.x, areaMin.y, areaMax.y);
             }
         }
-        for (auto &body : bodies) {
-            body->update();
+        if (sleeping)
+            updateSleep();
+        if (!interpolate)
+            syncTransforms();
+
+        updateCount++;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        quality.updateMs = elapsed.count();
+    }
+
+public:
+    void update(float deltaTime)
+    {
+        // Sleeping may have been turned off since the level was reached
+        qualityLevel = std::min(qualityLevel, maxQualityLevel());
+        quality = qualityFor(qualityLevel);
+        runUpdate(deltaTime);
+        adaptQuality(quality.updateMs);
+    }
+
+    // Keeps update() within milliseconds by trading accuracy for time, see
+    // qualityFor. 0 turns the budget off and restores full quality.
+    void setTimeBudget(float milliseconds)
+    {
+        budgetMs = std::max(0.0f, milliseconds);
+        qualityLevel = 0;
+        calmUpdates = 0;
+    }
+
+    float getTimeBudget() const
+    {
+        return budgetMs;
+    }
+
+    // Quality the last update ran at, and how long it took.
+    const EngineQuality &getQuality() const
+    {
+        return quality;
+    }
+
+    // Write-back to the scene graph, once per update: only bodies whose
+    // position changed since the last write get a new translate matrix.
+    void syncTransforms()
+    {
+        PHYSICS_PROFILE_SCOPE(profile, WriteBack);
+        BodyStore &s = *store;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            s.syncTransform(i);
+        }
+    }
+
+    // Writes the state blended between the previous and the current update,
+    // alpha being how far the renderer is into the next fixed step (0..1).
+    void writeInterpolatedTransforms(float alpha)
+    {
+        PHYSICS_PROFILE_SCOPE(profile, WriteBack);
+        BodyStore &s = *store;
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            s.syncTransform(i,
+                            s.prevX[i] + (s.x[i] - s.prevX[i]) * alpha,
+                            s.prevY[i] + (s.y[i] - s.prevY[i]) * alpha);
         }
     }
 
+    // When enabled, update() leaves the transforms alone and the renderer is
+    // expected to call writeInterpolatedTransforms(alpha) before drawing.
+    void setInterpolation(bool enabled)
+    {
+        interpolate = enabled;
+    }
+
+    void setBroadphase(Broadphase mode)
+    {
+        broadphase = mode;
+        gridGeneration = UINT64_MAX; // not kept up to date while brute force runs
+    }
+
+    Broadphase getBroadphase() const
+    {
+        return broadphase;
+    }
+
+    // Solves collisions on a pool of worker threads (grid broadphase only).
+    // 0 or 1 keeps the serial solver, whose pair order matches the brute-force path.
+    void setSolverThreads(int threads)
+    {
+        if (threads > 1)
+            solverPool.reset(new ThreadPool(threads));
+        else
+            solverPool.reset();
+    }
+
+    int getSolverThreads() const
+    {
+        return solverPool ? solverPool->size() : 1;
+    }
+
+    // Sweep-tests bodies that travel more than fraction * radius per substep,
+    // so small fast circles collide on the way instead of tunnelling.
+    // Only those bodies pay for it, so numSubsteps can stay low.
+    void setContinuousCollision(bool enabled, float fraction = 0.5f)
+    {
+        continuous = enabled;
+        sweepFraction = fraction;
+    }
+
+    bool getContinuousCollision() const
+    {
+        return continuous;
+    }
+
+    // Bodies slower than speed (units/s) for frames consecutive updates stop being
+    // integrated and stop colliding with other sleepers until something touches them.
+    void setSleeping(bool enabled, float speed = 0.05f, int frames = 30)
+    {
+        sleeping = enabled;
+        sleepSpeed = speed;
+        sleepFrames = frames;
+        if (!enabled)
+        {
+            for (size_t i = 0; i < store->size(); i++)
+            {
+                store->wake(i);
+            }
+        }
+    }
+
+    // Read-only view of the body arrays, for renderers that draw straight from them.
+    const BodyStore &getBodyStore() const
+    {
+        return *store;
+    }
+
+    const EngineStats &getStats() const
+    {
+        return stats;
+    }
+
+    // Time per phase of the last update (plus any interpolated write-back since).
+    // All zero when the timers are compiled out; see profiler::enabled().
+    const profiler::Times &getProfile() const
+    {
+        return profile;
+    }
+
+    size_t getSleepingCount() const
+    {
+        size_t count = 0;
+        for (float a : store->awake)
+        {
+            if (a == 0.0f)
+                count++;
+        }
+        return count;
+    }
+
+    // Forces a specific integration kernel; unsupported kinds fall back to the best available.
+    void setIntegrator(integrator::Kind kind)
+    {
+        integratorKind = (kind == integrator::Kind::Auto || !integrator::isSupported(kind)) ? integrator::detect() : kind;
+        integrateKernel = integrator::select(integratorKind);
+    }
+
+    integrator::Kind getIntegrator() const
+    {
+        return integratorKind;
+    }
+
     void multiplyGravity(float factor)
     {
         gravity *= factor;
+        record(ReplayEvent::Type::Gravity, 0, gravity);
     }
 
     void setGravity(glm::vec2 gravity)
     {
         this->gravity = gravity;
+        record(ReplayEvent::Type::Gravity, 0, gravity);
     }
 
     void addBody(PhysicsBodyPtr body)
     {
+        body->attach(store);
         bodies.push_back(body);
+        bodiesGeneration++;
+        recordSpawn(body->getIndex());
     }
 
     void clearBodies()
     {
+        record(ReplayEvent::Type::Clear);
+        recordedInvMass.clear();
+        recordedRestitution.clear();
+        recordedFriction.clear();
+        // Handles held elsewhere keep working on a private copy of their state.
+        for (auto &body : bodies)
+        {
+            body->detach();
+        }
+        bodies.clear();
+        store->clear();
+        constraints->clear();
+        bodiesGeneration++;
+    }
+
+    // Pre-allocates storage and handles for count bodies, so spawnBody and
+    // despawnBody never touch the allocator while the total stays below count.
+    void reserveBodies(size_t count)
+    {
+        store->reserve(count);
+        bodies.reserve(count);
+        asleepAtStart.reserve(count);
+        wakeQueue.reserve(count);
+        pool.reserve(count);
+        while (bodies.size() + pool.size() < count)
+        {
+            pool.push_back(PhysicsBodyPtr(new PhysicsBody()));
+        }
+    }
+
+    // Activates a pooled body. Falls back to allocating a new handle when the pool is empty.
+    PhysicsBodyPtr spawnBody(const glm::vec2 &position, float radius, transform::TransformPtr nodeTransform = nullptr)
+    {
+        PhysicsBodyPtr body = takeHandle();
+        body->index = store->add(position, position, glm::vec2(0.0f, 0.0f), radius, nodeTransform);
+        body->store = store;
+        bodies.push_back(body);
+        bodiesGeneration++;
+        recordSpawn(body->index);
+        return body;
+    }
+
+    // Returns a body to the pool. The handle must not be used again until spawnBody hands it back.
+    void despawnBody(const PhysicsBodyPtr &body)
+    {
+        size_t i = body->index;
+        if (body->store != store || i >= bodies.size() || bodies[i] != body)
+            return;
+        despawnAt(i);
+    }
+
+    // Static obstacles, collided against by every body. Their ids stay valid until clearObstacles.
+    size_t addSegment(const glm::vec2 &a, const glm::vec2 &b)
+    {
+        return obstacles->addSegment(a, b);
+    }
+
+    size_t addCapsule(const glm::vec2 &a, const glm::vec2 &b, float radius)
+    {
+        return obstacles->addCapsule(a, b, radius);
+    }
+
+    size_t addPolygon(const std::vector<glm::vec2> &points)
+    {
+        return obstacles->addPolygon(points);
+    }
+
+    // Moves an obstacle kinematically and wakes any sleeping body it passes over.
+    void moveObstacle(size_t id, const glm::vec2 &offset)
+    {
+        if (id >= obstacles->size())
+            return;
+        const Obstacle &o = obstacles->get(id);
+        glm::vec2 sweepMin = glm::vec2(std::min(o.boundsMin.x, o.boundsMin.x + offset.x), std::min(o.boundsMin.y, o.boundsMin.y + offset.y));
+        glm::vec2 sweepMax = glm::vec2(std::max(o.boundsMax.x, o.boundsMax.x + offset.x), std::max(o.boundsMax.y, o.boundsMax.y + offset.y));
+        obstacles->translate(id, offset);
+        wakeInBox(sweepMin, sweepMax);
+    }
+
+    // Field acting on the bodies within radius of center; see ForceFieldKind.
+    // Strength is an acceleration for the radial kinds and a rate (1/s) for Drag.
+    size_t addForceField(ForceFieldKind kind, const glm::vec2 &center, float radius, float strength)
+    {
+        wakeInBox(center - glm::vec2(radius, radius), center + glm::vec2(radius, radius));
+        return fields->add(kind, center, radius, strength);
+    }
+
+    void moveForceField(size_t id, const glm::vec2 &center)
+    {
+        if (id >= fields->size())
+            return;
+        ForceFieldSet &f = *fields;
+        f.x[id] = center.x;
+        f.y[id] = center.y;
+        wakeInBox(center - glm::vec2(f.radius[id], f.radius[id]), center + glm::vec2(f.radius[id], f.radius[id]));
+    }
+
+    // 0 switches a field off without changing the ids of the others.
+    void setForceFieldStrength(size_t id, float strength)
+    {
+        if (id >= fields->size())
+            return;
+        ForceFieldSet &f = *fields;
+        f.strength[id] = strength;
+        wakeInBox(glm::vec2(f.x[id] - f.radius[id], f.y[id] - f.radius[id]), glm::vec2(f.x[id] + f.radius[id], f.y[id] + f.radius[id]));
+    }
+
+    void clearForceFields()
+    {
+        fields->clear();
+    }
+
+    ForceFieldSetPtr getForceFields() const
+    {
+        return fields;
+    }
+
+    void clearObstacles()
+    {
+        obstacles->clear();
+    }
+
+    ObstacleSetPtr getObstacles() const
+    {
+        return obstacles;
+    }
+
+    // Distance link between two bodies of this engine; restLength < 0 keeps their current distance.
+    void addLink(const PhysicsBodyPtr &a, const PhysicsBodyPtr &b, float stiffness = 1.0f, float restLength = -1.0f)
+    {
+        uint32_t ia, ib;
+        if (!ownIndex(a, ia) || !ownIndex(b, ib))
+            return;
+        if (restLength < 0.0f)
+            restLength = glm::length(a->getPosition() - b->getPosition());
+        constraints->addLink(ia, ib, restLength, stiffness);
+    }
+
+    // Holds body at position; call again to move the pin.
+    void pinBody(const PhysicsBodyPtr &body, const glm::vec2 &position)
+    {
+        uint32_t index;
+        if (ownIndex(body, index))
+            constraints->setPin(index, position.x, position.y);
+    }
+
+    void pinBody(const PhysicsBodyPtr &body)
+    {
+        pinBody(body, body->getPosition());
+    }
+
+    void unpinBody(const PhysicsBodyPtr &body)
+    {
+        uint32_t index;
+        if (ownIndex(body, index))
+            constraints->removePin(index);
+    }
+
+    // Keeps the angle a-center-c (radians, 0..pi) within [minAngle, maxAngle].
+    void addAngleLimit(const PhysicsBodyPtr &a, const PhysicsBodyPtr &center, const PhysicsBodyPtr &c, float minAngle, float maxAngle)
+    {
+        uint32_t ia, ib, ic;
+        if (!ownIndex(a, ia) || !ownIndex(center, ib) || !ownIndex(c, ic))
+            return;
+        constraints->addAngleLimit(ia, ib, ic, minAngle, maxAngle);
+    }
+
+    void clearConstraints()
+    {
+        constraints->clear();
+    }
+
+    ConstraintSetPtr getConstraints() const
+    {
+        return constraints;
+    }
+
+    // Compact binary copy of the whole simulation state: body arrays, gravity,
+    // area, solver, collision and budget settings. Node transforms, obstacles, constraints and
+    // force fields are not part of it.
+    void saveSnapshot(std::vector<uint8_t> &out) const
+    {
+        const BodyStore &s = *store;
+        const size_t count = s.size();
+        SnapshotHeader header = {};
+        header.magic = SNAPSHOT_MAGIC;
+        header.version = SNAPSHOT_VERSION;
+        header.count = count;
+        header.gravity[0] = gravity.x;
+        header.gravity[1] = gravity.y;
+        header.areaMin[0] = areaMin.x;
+        header.areaMin[1] = areaMin.y;
+        header.areaMax[0] = areaMax.x;
+        header.areaMax[1] = areaMax.y;
+        header.numSubsteps = numSubsteps;
+        header.solverSteps = solverSteps;
+        header.sleepSpeed = sleepSpeed;
+        header.sleepFrames = sleepFrames;
+        header.rigid = rigid;
+        header.sleeping = sleeping;
+        header.interpolate = interpolate;
+        header.continuous = continuous;
+        header.broadphase = static_cast<uint8_t>(broadphase);
+        header.sweepFraction = sweepFraction;
+        header.budgetMs = budgetMs;
+        header.updateCount = updateCount;
+
+        out.resize(sizeof(SnapshotHeader) + count * SNAPSHOT_ARRAYS * sizeof(float));
+        uint8_t *cursor = out.data();
+        std::memcpy(cursor, &header, sizeof(header));
+        cursor += sizeof(header);
+        auto write = [&](const void *data) {
+            std::memcpy(cursor, data, count * sizeof(float));
+            cursor += count * sizeof(float);
+        };
+        write(s.x.data());
+        write(s.y.data());
+        write(s.oldX.data());
+        write(s.oldY.data());
+        write(s.ax.data());
+        write(s.ay.data());
+        write(s.r.data());
+        write(s.awake.data());
+        write(s.stillFrames.data());
+        write(s.prevX.data());
+        write(s.prevY.data());
+        write(s.invMass.data());
+        write(s.restitution.data());
+        write(s.friction.data());
+    }
+
+    std::vector<uint8_t> saveSnapshot() const
+    {
+        std::vector<uint8_t> out;
+        saveSnapshot(out);
+        return out;
+    }
+
+    // Replaces the simulation state with a snapshot. Node transforms are kept by
+    // index, but every handle from before is detached, as in clearBodies: it keeps
+    // a private copy of its old state and no longer belongs to the engine. The
+    // restored bodies get new handles (see getBody).
+    bool restoreSnapshot(const uint8_t *data, size_t size)
+    {
+        SnapshotHeader header;
+        if (size < sizeof(header))
+        {
+            std::cerr << "Physics snapshot too small" << std::endl;
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+            size != sizeof(header) + header.count * SNAPSHOT_ARRAYS * sizeof(float))
+        {
+            std::cerr << "Invalid physics snapshot" << std::endl;
+            return false;
+        }
+
+        const size_t count = static_cast<size_t>(header.count);
+        gravity = glm::vec2(header.gravity[0], header.gravity[1]);
+        areaMin = glm::vec2(header.areaMin[0], header.areaMin[1]);
+        areaMax = glm::vec2(header.areaMax[0], header.areaMax[1]);
+        numSubsteps = header.numSubsteps;
+        solverSteps = header.solverSteps;
+        sleepSpeed = header.sleepSpeed;
+        sleepFrames = header.sleepFrames;
+        rigid = header.rigid != 0;
+        sleeping = header.sleeping != 0;
+        interpolate = header.interpolate != 0;
+        continuous = header.continuous != 0;
+        broadphase = header.broadphase == static_cast<uint8_t>(Broadphase::BruteForce) ? Broadphase::BruteForce : Broadphase::Grid;
+        sweepFraction = header.sweepFraction;
+        budgetMs = header.budgetMs;
+        updateCount = header.updateCount;
+        qualityLevel = 0;
+        calmUpdates = 0;
+
+        for (auto &body : bodies)
+        {
+            body->detach();
+        }
         bodies.clear();
+        while (bodies.size() < count)
+        {
+            PhysicsBodyPtr body = takeHandle();
+            body->store = store;
+            body->index = bodies.size();
+            bodies.push_back(body);
+        }
+
+        BodyStore &s = *store;
+        s.resize(count);
+        bodiesGeneration++;
+        constraints->invalidate();
+        const uint8_t *cursor = data + sizeof(header);
+        auto read = [&](void *target) {
+            std::memcpy(target, cursor, count * sizeof(float));
+            cursor += count * sizeof(float);
+        };
+        read(s.x.data());
+        read(s.y.data());
+        read(s.oldX.data());
+        read(s.oldY.data());
+        read(s.ax.data());
+        read(s.ay.data());
+        read(s.r.data());
+        read(s.awake.data());
+        read(s.stillFrames.data());
+        read(s.prevX.data());
+        read(s.prevY.data());
+        read(s.invMass.data());
+        read(s.restitution.data());
+        read(s.friction.data());
+        if (recording)
+            resetRecordedMaterials();
+        return true;
+    }
+
+    bool restoreSnapshot(const std::vector<uint8_t> &snapshot)
+    {
+        return restoreSnapshot(snapshot.data(), snapshot.size());
+    }
+
+    // Starts logging every external change (steps, spawns, gravity, clears) into log,
+    // after storing a snapshot of the current state in it.
+    void startRecording(ReplayLogPtr log)
+    {
+        recording.reset();
+        log->snapshot = saveSnapshot();
+        log->events.clear();
+        recording = log;
+        resetRecordedMaterials();
+    }
+
+    ReplayLogPtr stopRecording()
+    {
+        ReplayLogPtr log = recording;
+        recording.reset();
+        return log;
+    }
+
+    // Restores the log's snapshot and re-applies its events as fast as possible.
+    // onStep, if given, receives each step's index and its update time in milliseconds.
+    bool replay(const ReplayLog &log, const std::function<void(size_t, double)> &onStep = nullptr)
+    {
+        ReplayLogPtr wasRecording = recording;
+        recording.reset();
+        if (!restoreSnapshot(log.snapshot))
+        {
+            recording = wasRecording;
+            return false;
+        }
+
+        size_t step = 0;
+        for (const ReplayEvent &event : log.events)
+        {
+            switch (event.type)
+            {
+            case ReplayEvent::Type::Step:
+            {
+                // The recorded quality, not the budget's pick for this machine
+                quality = qualityFor(0);
+                quality.substeps = std::max(1, event.substeps);
+                quality.solverSteps = std::max(1, event.solverSteps);
+                quality.sleepInterval = std::max(1, event.sleepInterval);
+                auto start = std::chrono::steady_clock::now();
+                runUpdate(event.deltaTime);
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                if (onStep) onStep(step, elapsed.count());
+                step++;
+                break;
+            }
+            case ReplayEvent::Type::Spawn:
+            {
+                PhysicsBodyPtr body = PhysicsBody::Make(glm::vec2(event.oldX, event.oldY), glm::vec2(event.x, event.y), nullptr, event.radius);
+                addBody(body);
+                store->invMass[body->index] = event.invMass;
+                store->restitution[body->index] = event.restitution;
+                store->friction[body->index] = event.friction;
+                break;
+            }
+            case ReplayEvent::Type::Material:
+                if (event.index < bodies.size())
+                {
+                    store->invMass[event.index] = event.invMass;
+                    store->restitution[event.index] = event.restitution;
+                    store->friction[event.index] = event.friction;
+                }
+                break;
+            case ReplayEvent::Type::Despawn:
+                if (event.index < bodies.size()) despawnAt(event.index);
+                break;
+            case ReplayEvent::Type::Gravity:
+                gravity = glm::vec2(event.x, event.y);
+                break;
+            case ReplayEvent::Type::Clear:
+                clearBodies();
+                break;
+            }
+        }
+        recording = wasRecording;
+        return true;
+    }
+
+    size_t getPooledCount() const
+    {
+        return pool.size();
+    }
+
+    size_t getBodyCount() const
+    {
+        return store->size();
+    }
+
+    // Handle of the body at index; indices shift when bodies are removed.
+    PhysicsBodyPtr getBody(size_t index) const
+    {
+        return index < bodies.size() ? bodies[index] : nullptr;
     }
 
     void setArea(float minX, float maxX, float minY, float maxY)
     {
-        areaMin = glm::vec2(minX, minY);
-        areaMax = glm::vec2(maxX, maxY);
+        setArea(glm::vec2(minX, minY), glm::vec2(maxX, maxY));
     }
 
     void setArea(glm::vec2 min, glm::vec2 max)
     {
         areaMin = min;
         areaMax = max;
+        gridGeneration = UINT64_MAX; // built for the old area
     }
 };
\ No newline at end of file
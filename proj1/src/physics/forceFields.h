@@ -0,0 +1,102 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+class ForceFieldSet;
+using ForceFieldSetPtr = std::shared_ptr<ForceFieldSet>;
+
+enum class ForceFieldKind
+{
+    Attractor, // pulls towards the center
+    Repulsor,  // pushes away from the center
+    Vortex,    // spins counter-clockwise around the center
+    Drag       // slows bodies down
+};
+
+// Circular force fields, stored as parallel arrays. Each one only reaches
+// bodies within its radius; strength fades linearly to 0 at the edge for the
+// radial kinds. The Engine finds the bodies a field covers through its
+// broadphase grid and adds the result to their acceleration.
+class ForceFieldSet
+{
+private:
+    ForceFieldSet() {}
+
+public:
+    std::vector<ForceFieldKind> kind;
+    std::vector<float> x, y;
+    std::vector<float> radius;
+    std::vector<float> strength;
+
+    static ForceFieldSetPtr Make()
+    {
+        return ForceFieldSetPtr(new ForceFieldSet());
+    }
+
+    size_t add(ForceFieldKind fieldKind, const glm::vec2 &center, float fieldRadius, float fieldStrength)
+    {
+        kind.push_back(fieldKind);
+        x.push_back(center.x);
+        y.push_back(center.y);
+        radius.push_back(fieldRadius);
+        strength.push_back(fieldStrength);
+        return kind.size() - 1;
+    }
+
+    size_t size() const
+    {
+        return kind.size();
+    }
+
+    bool empty() const
+    {
+        return kind.empty();
+    }
+
+    void clear()
+    {
+        kind.clear();
+        x.clear();
+        y.clear();
+        radius.clear();
+        strength.clear();
+    }
+
+    // Acceleration field f gives a body at p moving by velocity per second.
+    // Returns false when p is outside the field.
+    bool evaluate(size_t f, const glm::vec2 &p, const glm::vec2 &velocity, glm::vec2 &accel) const
+    {
+        glm::vec2 offset = p - glm::vec2(x[f], y[f]);
+        float distSq = glm::dot(offset, offset);
+        if (distSq >= radius[f] * radius[f])
+            return false;
+
+        if (kind[f] == ForceFieldKind::Drag)
+        {
+            accel = -velocity * strength[f];
+            return true;
+        }
+
+        float distance = std::sqrt(distSq);
+        if (distance == 0.0f)
+            return false;
+        glm::vec2 direction = offset / distance;
+        float magnitude = strength[f] * (1.0f - distance / radius[f]);
+        switch (kind[f])
+        {
+        case ForceFieldKind::Attractor:
+            accel = -direction * magnitude;
+            break;
+        case ForceFieldKind::Repulsor:
+            accel = direction * magnitude;
+            break;
+        default:
+            accel = glm::vec2(-direction.y, direction.x) * magnitude;
+            break;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include "bodyStore.h"
+#include <vector>
+
+// Per-instance data of one circle, laid out as a vec4 attribute:
+// center, radius, and 1/0 for awake/sleeping (the shader dims sleepers).
+struct CircleInstance
+{
+    float x, y;
+    float radius;
+    float awake;
+};
+
+// Packs every body into out, blended between the previous and the current
+// update by alpha like Engine::writeInterpolatedTransforms. Bodies is a
+// BodyStore or anything with the same arrays (PhysicsSnapshot). No GL
+// involved, so it runs the same in the benchmark as in the renderer.
+template <typename Bodies>
+size_t packCircleInstances(const Bodies &bodies, float alpha, std::vector<CircleInstance> &out)
+{
+    const size_t count = bodies.size();
+    out.resize(count);
+    CircleInstance *instance = out.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        instance[i].x = bodies.prevX[i] + (bodies.x[i] - bodies.prevX[i]) * alpha;
+        instance[i].y = bodies.prevY[i] + (bodies.y[i] - bodies.prevY[i]) * alpha;
+        instance[i].radius = bodies.r[i];
+        instance[i].awake = bodies.awake[i];
+    }
+    return count;
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PHYSICS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Batched Verlet integration over the BodyStore arrays.
+// Every kernel computes x += (x - oldX) + (ax + g) * dt * dt in the same
+// operation order, so they all produce bit-identical positions.
+namespace integrator {
+
+enum class Kind
+{
+    Auto,
+    Scalar,
+    SSE, // 4 bodies per instruction
+    AVX  // 8 bodies per instruction
+};
+
+// Raw views of the BodyStore arrays handed to the kernels. awake is an
+// optional 1.0/0.0 mask; bodies with 0.0 keep their position and drop any
+// accumulated acceleration. Multiplying by 1.0 is exact, so the masked
+// path gives the same bits as the unmasked one for awake bodies.
+struct Arrays
+{
+    float *x, *y;
+    float *oldX, *oldY;
+    float *ax, *ay;
+    const float *awake;
+    size_t count;
+};
+
+using Kernel = void (*)(const Arrays &bodies, float gravityX, float gravityY, float deltaTime);
+
+inline void integrateScalar(const Arrays &b, size_t begin, float gravityX, float gravityY, float deltaTime)
+{
+    for (size_t i = begin; i < b.count; i++)
+    {
+        float accelX = b.ax[i] + gravityX;
+        float accelY = b.ay[i] + gravityY;
+        float velocityX = b.x[i] - b.oldX[i];
+        float velocityY = b.y[i] - b.oldY[i];
+        b.oldX[i] = b.x[i];
+        b.oldY[i] = b.y[i];
+        if (b.awake)
+        {
+            b.x[i] += (velocityX + accelX * deltaTime * deltaTime) * b.awake[i];
+            b.y[i] += (velocityY + accelY * deltaTime * deltaTime) * b.awake[i];
+        }
+        else
+        {
+            b.x[i] += velocityX + accelX * deltaTime * deltaTime;
+            b.y[i] += velocityY + accelY * deltaTime * deltaTime;
+        }
+        b.ax[i] = 0.0f;
+        b.ay[i] = 0.0f;
+    }
+}
+
+inline void integrateScalar(const Arrays &bodies, float gravityX, float gravityY, float deltaTime)
+{
+    integrateScalar(bodies, 0, gravityX, gravityY, deltaTime);
+}
+
+#ifdef PHYSICS_X86_SIMD
+
+template <bool Masked>
+__attribute__((target("sse2")))
+inline void integrateSSEBody(const Arrays &b, float gravityX, float gravityY, float deltaTime)
+{
+    const __m128 gx = _mm_set1_ps(gravityX);
+    const __m128 gy = _mm_set1_ps(gravityY);
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= b.count; i += 4)
+    {
+        __m128 px = _mm_loadu_ps(b.x + i);
+        __m128 py = _mm_loadu_ps(b.y + i);
+        __m128 vx = _mm_sub_ps(px, _mm_loadu_ps(b.oldX + i));
+        __m128 vy = _mm_sub_ps(py, _mm_loadu_ps(b.oldY + i));
+        __m128 accX = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(b.ax + i), gx), dt), dt);
+        __m128 accY = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(b.ay + i), gy), dt), dt);
+        __m128 stepX = _mm_add_ps(vx, accX);
+        __m128 stepY = _mm_add_ps(vy, accY);
+        if (Masked)
+        {
+            __m128 awake = _mm_loadu_ps(b.awake + i);
+            stepX = _mm_mul_ps(stepX, awake);
+            stepY = _mm_mul_ps(stepY, awake);
+        }
+        _mm_storeu_ps(b.oldX + i, px);
+        _mm_storeu_ps(b.oldY + i, py);
+        _mm_storeu_ps(b.x + i, _mm_add_ps(px, stepX));
+        _mm_storeu_ps(b.y + i, _mm_add_ps(py, stepY));
+        _mm_storeu_ps(b.ax + i, zero);
+        _mm_storeu_ps(b.ay + i, zero);
+    }
+    integrateScalar(b, i, gravityX, gravityY, deltaTime);
+}
+
+template <bool Masked>
+__attribute__((target("avx")))
+inline void integrateAVXBody(const Arrays &b, float gravityX, float gravityY, float deltaTime)
+{
+    const __m256 gx = _mm256_set1_ps(gravityX);
+    const __m256 gy = _mm256_set1_ps(gravityY);
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= b.count; i += 8)
+    {
+        __m256 px = _mm256_loadu_ps(b.x + i);
+        __m256 py = _mm256_loadu_ps(b.y + i);
+        __m256 vx = _mm256_sub_ps(px, _mm256_loadu_ps(b.oldX + i));
+        __m256 vy = _mm256_sub_ps(py, _mm256_loadu_ps(b.oldY + i));
+        __m256 accX = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(b.ax + i), gx), dt), dt);
+        __m256 accY = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(b.ay + i), gy), dt), dt);
+        __m256 stepX = _mm256_add_ps(vx, accX);
+        __m256 stepY = _mm256_add_ps(vy, accY);
+        if (Masked)
+        {
+            __m256 awake = _mm256_loadu_ps(b.awake + i);
+            stepX = _mm256_mul_ps(stepX, awake);
+            stepY = _mm256_mul_ps(stepY, awake);
+        }
+        _mm256_storeu_ps(b.oldX + i, px);
+        _mm256_storeu_ps(b.oldY + i, py);
+        _mm256_storeu_ps(b.x + i, _mm256_add_ps(px, stepX));
+        _mm256_storeu_ps(b.y + i, _mm256_add_ps(py, stepY));
+        _mm256_storeu_ps(b.ax + i, zero);
+        _mm256_storeu_ps(b.ay + i, zero);
+    }
+    integrateScalar(b, i, gravityX, gravityY, deltaTime);
+}
+
+inline void integrateSSE(const Arrays &bodies, float gravityX, float gravityY, float deltaTime)
+{
+    if (bodies.awake)
+        integrateSSEBody<true>(bodies, gravityX, gravityY, deltaTime);
+    else
+        integrateSSEBody<false>(bodies, gravityX, gravityY, deltaTime);
+}
+
+inline void integrateAVX(const Arrays &bodies, float gravityX, float gravityY, float deltaTime)
+{
+    if (bodies.awake)
+        integrateAVXBody<true>(bodies, gravityX, gravityY, deltaTime);
+    else
+        integrateAVXBody<false>(bodies, gravityX, gravityY, deltaTime);
+}
+
+#endif
+
+inline bool isSupported(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::Auto:
+    case Kind::Scalar:
+        return true;
+#ifdef PHYSICS_X86_SIMD
+    case Kind::SSE:
+        return __builtin_cpu_supports("sse2");
+    case Kind::AVX:
+        return __builtin_cpu_supports("avx");
+#endif
+    default:
+        return false;
+    }
+}
+
+// Best kernel for this CPU, detected once on first use.
+inline Kind detect()
+{
+    static const Kind best = isSupported(Kind::AVX) ? Kind::AVX
+                           : isSupported(Kind::SSE) ? Kind::SSE
+                           : Kind::Scalar;
+    return best;
+}
+
+// Resolves a kind to a kernel, falling back to the best supported one.
+inline Kernel select(Kind kind = Kind::Auto)
+{
+    if (kind == Kind::Auto || !isSupported(kind))
+        kind = detect();
+
+    switch (kind)
+    {
+#ifdef PHYSICS_X86_SIMD
+    case Kind::AVX:
+        return integrateAVX;
+    case Kind::SSE:
+        return integrateSSE;
+#endif
+    default:
+        return static_cast<Kernel>(integrateScalar);
+    }
+}
+
+inline const char *name(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::Scalar: return "scalar";
+    case Kind::SSE: return "sse";
+    case Kind::AVX: return "avx";
+    default: return "auto";
+    }
+}
+
+} // namespace integrator
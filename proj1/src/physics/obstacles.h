@@ -0,0 +1,386 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+class ObstacleSet;
+using ObstacleSetPtr = std::shared_ptr<ObstacleSet>;
+
+// Fixed or script-driven shape the bodies collide against. A segment is a
+// capsule with radius 0; polygons are convex, with their vertices stored
+// counter-clockwise in ObstacleSet::vertices.
+struct Obstacle
+{
+    enum class Kind
+    {
+        Capsule,
+        Polygon
+    };
+
+    Kind kind;
+    glm::vec2 a, b;        // capsule end points
+    float radius;          // capsule radius
+    size_t firstVertex;    // polygon vertices [firstVertex, firstVertex + vertexCount)
+    size_t vertexCount;
+    glm::vec2 boundsMin, boundsMax;
+};
+
+// Obstacles plus a bounding volume hierarchy over them. The tree is built on
+// the first query after shapes are added and only refitted when a kinematic
+// obstacle moves, so the static part costs nothing per step.
+class ObstacleSet
+{
+private:
+    struct Node
+    {
+        glm::vec2 boundsMin, boundsMax;
+        int left = -1;  // children; -1 for leaves
+        int right = -1;
+        size_t first = 0; // leaf range in order
+        size_t count = 0;
+    };
+
+    static const size_t LEAF_SIZE = 4;
+
+    std::vector<Obstacle> obstacles;
+    std::vector<glm::vec2> vertices;
+    std::vector<Node> nodes;
+    std::vector<size_t> order;
+    std::vector<int> stack;
+    bool rebuild = false;
+    bool refit = false;
+
+    ObstacleSet() {}
+
+    static bool overlaps(const glm::vec2 &minA, const glm::vec2 &maxA, const glm::vec2 &minB, const glm::vec2 &maxB)
+    {
+        return minA.x <= maxB.x && maxA.x >= minB.x && minA.y <= maxB.y && maxA.y >= minB.y;
+    }
+
+    void computeBounds(Obstacle &o) const
+    {
+        if (o.kind == Obstacle::Kind::Capsule)
+        {
+            o.boundsMin = glm::vec2(std::min(o.a.x, o.b.x) - o.radius, std::min(o.a.y, o.b.y) - o.radius);
+            o.boundsMax = glm::vec2(std::max(o.a.x, o.b.x) + o.radius, std::max(o.a.y, o.b.y) + o.radius);
+            return;
+        }
+        if (o.vertexCount == 0)
+            return;
+        o.boundsMin = o.boundsMax = vertices[o.firstVertex];
+        for (size_t k = 1; k < o.vertexCount; k++)
+        {
+            const glm::vec2 &v = vertices[o.firstVertex + k];
+            o.boundsMin = glm::vec2(std::min(o.boundsMin.x, v.x), std::min(o.boundsMin.y, v.y));
+            o.boundsMax = glm::vec2(std::max(o.boundsMax.x, v.x), std::max(o.boundsMax.y, v.y));
+        }
+    }
+
+    void fitNode(Node &node) const
+    {
+        if (node.left >= 0)
+        {
+            const Node &l = nodes[node.left];
+            const Node &r = nodes[node.right];
+            node.boundsMin = glm::vec2(std::min(l.boundsMin.x, r.boundsMin.x), std::min(l.boundsMin.y, r.boundsMin.y));
+            node.boundsMax = glm::vec2(std::max(l.boundsMax.x, r.boundsMax.x), std::max(l.boundsMax.y, r.boundsMax.y));
+            return;
+        }
+        node.boundsMin = obstacles[order[node.first]].boundsMin;
+        node.boundsMax = obstacles[order[node.first]].boundsMax;
+        for (size_t k = 1; k < node.count; k++)
+        {
+            const Obstacle &o = obstacles[order[node.first + k]];
+            node.boundsMin = glm::vec2(std::min(node.boundsMin.x, o.boundsMin.x), std::min(node.boundsMin.y, o.boundsMin.y));
+            node.boundsMax = glm::vec2(std::max(node.boundsMax.x, o.boundsMax.x), std::max(node.boundsMax.y, o.boundsMax.y));
+        }
+    }
+
+    // Median split on the longest axis of the node's centroids.
+    int buildNode(size_t first, size_t count)
+    {
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back(Node());
+        nodes[index].first = first;
+        nodes[index].count = count;
+
+        if (count > LEAF_SIZE)
+        {
+            glm::vec2 lo = obstacles[order[first]].boundsMin + obstacles[order[first]].boundsMax;
+            glm::vec2 hi = lo;
+            for (size_t k = first + 1; k < first + count; k++)
+            {
+                glm::vec2 c = obstacles[order[k]].boundsMin + obstacles[order[k]].boundsMax;
+                lo = glm::vec2(std::min(lo.x, c.x), std::min(lo.y, c.y));
+                hi = glm::vec2(std::max(hi.x, c.x), std::max(hi.y, c.y));
+            }
+            int axis = (hi.x - lo.x) >= (hi.y - lo.y) ? 0 : 1;
+            size_t half = count / 2;
+            std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                             [this, axis](size_t p, size_t q) {
+                                 return obstacles[p].boundsMin[axis] + obstacles[p].boundsMax[axis] <
+                                        obstacles[q].boundsMin[axis] + obstacles[q].boundsMax[axis];
+                             });
+            int left = buildNode(first, half);
+            int right = buildNode(first + half, count - half);
+            nodes[index].left = left;
+            nodes[index].right = right;
+        }
+        fitNode(nodes[index]);
+        return index;
+    }
+
+    void prepare()
+    {
+        if (rebuild)
+        {
+            nodes.clear();
+            order.resize(obstacles.size());
+            for (size_t k = 0; k < order.size(); k++) order[k] = k;
+            if (!obstacles.empty())
+                buildNode(0, obstacles.size());
+            rebuild = false;
+            refit = false;
+        }
+        else if (refit)
+        {
+            // Children always come after their parent, so a reverse sweep refits bottom-up.
+            for (size_t k = nodes.size(); k-- > 0;)
+                fitNode(nodes[k]);
+            refit = false;
+        }
+    }
+
+    size_t add(const Obstacle &obstacle)
+    {
+        obstacles.push_back(obstacle);
+        computeBounds(obstacles.back());
+        rebuild = true;
+        return obstacles.size() - 1;
+    }
+
+    static glm::vec2 closestOnSegment(const glm::vec2 &p, const glm::vec2 &a, const glm::vec2 &b)
+    {
+        glm::vec2 ab = b - a;
+        float lengthSq = glm::dot(ab, ab);
+        float t = lengthSq > 0.0f ? std::max(0.0f, std::min(1.0f, glm::dot(p - a, ab) / lengthSq)) : 0.0f;
+        return a + ab * t;
+    }
+
+    bool pushFromCapsule(const Obstacle &o, const glm::vec2 &p, float radius, glm::vec2 &push) const
+    {
+        glm::vec2 delta = p - closestOnSegment(p, o.a, o.b);
+        float distance = glm::length(delta);
+        float minDistance = radius + o.radius;
+        if (distance >= minDistance || distance == 0.0f)
+            return false;
+        push = delta * ((minDistance - distance) / distance);
+        return true;
+    }
+
+    bool pushFromPolygon(const Obstacle &o, const glm::vec2 &p, float radius, glm::vec2 &push) const
+    {
+        // Deepest separating edge; a center inside the polygon leaves through it.
+        float maxSeparation = -INFINITY;
+        glm::vec2 maxNormal(0.0f, 0.0f);
+        glm::vec2 closest(0.0f, 0.0f);
+        float closestSq = INFINITY;
+        for (size_t k = 0; k < o.vertexCount; k++)
+        {
+            const glm::vec2 &a = vertices[o.firstVertex + k];
+            const glm::vec2 &b = vertices[o.firstVertex + (k + 1) % o.vertexCount];
+            glm::vec2 normal = glm::normalize(glm::vec2(b.y - a.y, a.x - b.x));
+            float separation = glm::dot(p - a, normal);
+            if (separation > maxSeparation)
+            {
+                maxSeparation = separation;
+                maxNormal = normal;
+            }
+            glm::vec2 c = closestOnSegment(p, a, b);
+            float distSq = glm::dot(p - c, p - c);
+            if (distSq < closestSq)
+            {
+                closestSq = distSq;
+                closest = c;
+            }
+        }
+
+        if (maxSeparation >= radius)
+            return false;
+        if (maxSeparation <= 0.0f)
+        {
+            push = maxNormal * (radius - maxSeparation);
+            return true;
+        }
+        float distance = std::sqrt(closestSq);
+        if (distance >= radius || distance == 0.0f)
+            return false;
+        push = (p - closest) * ((radius - distance) / distance);
+        return true;
+    }
+
+public:
+    // Returned by addPolygon for a rejected polygon.
+    static constexpr size_t INVALID_ID = SIZE_MAX;
+
+    static ObstacleSetPtr Make()
+    {
+        return ObstacleSetPtr(new ObstacleSet());
+    }
+
+    size_t addSegment(const glm::vec2 &a, const glm::vec2 &b)
+    {
+        return addCapsule(a, b, 0.0f);
+    }
+
+    size_t addCapsule(const glm::vec2 &a, const glm::vec2 &b, float radius)
+    {
+        Obstacle o = {};
+        o.kind = Obstacle::Kind::Capsule;
+        o.a = a;
+        o.b = b;
+        o.radius = radius;
+        return add(o);
+    }
+
+    // points must describe a convex polygon, in either winding. Repeated
+    // consecutive points (last == first included) are dropped; a polygon left
+    // with fewer than 3 points, or with no area, is rejected with INVALID_ID.
+    size_t addPolygon(const std::vector<glm::vec2> &input)
+    {
+        // Closer than this counts as the same point; a zero-length edge has no normal
+        static const float MIN_EDGE_SQ = 1e-12f;
+        auto same = [](const glm::vec2 &a, const glm::vec2 &b) {
+            return glm::dot(b - a, b - a) <= MIN_EDGE_SQ;
+        };
+        std::vector<glm::vec2> points;
+        points.reserve(input.size());
+        for (const glm::vec2 &p : input)
+        {
+            if (points.empty() || !same(points.back(), p))
+                points.push_back(p);
+        }
+        while (points.size() > 1 && same(points.back(), points.front()))
+            points.pop_back();
+        if (points.size() < 3)
+        {
+            std::cerr << "Obstacle polygon needs at least 3 distinct points, got " << points.size() << std::endl;
+            return INVALID_ID;
+        }
+
+        glm::vec2 lo = points[0], hi = points[0];
+        float area = 0.0f;
+        for (size_t k = 0; k < points.size(); k++)
+        {
+            const glm::vec2 &a = points[k];
+            const glm::vec2 &b = points[(k + 1) % points.size()];
+            area += a.x * b.y - b.x * a.y;
+            lo = glm::min(lo, a);
+            hi = glm::max(hi, a);
+        }
+        // Collinear points: twice the area is ~0 next to the squared extent
+        glm::vec2 extent = hi - lo;
+        if (std::abs(area) <= 1e-6f * glm::dot(extent, extent))
+        {
+            std::cerr << "Obstacle polygon has no area" << std::endl;
+            return INVALID_ID;
+        }
+
+        Obstacle o = {};
+        o.kind = Obstacle::Kind::Polygon;
+        o.firstVertex = vertices.size();
+        o.vertexCount = points.size();
+        if (area > 0.0f)
+            vertices.insert(vertices.end(), points.begin(), points.end());
+        else
+            vertices.insert(vertices.end(), points.rbegin(), points.rend());
+        return add(o);
+    }
+
+    // Moves a kinematic obstacle by offset; the tree is refitted on the next query.
+    void translate(size_t id, const glm::vec2 &offset)
+    {
+        Obstacle &o = obstacles[id];
+        if (o.kind == Obstacle::Kind::Capsule)
+        {
+            o.a += offset;
+            o.b += offset;
+        }
+        else
+        {
+            for (size_t k = 0; k < o.vertexCount; k++)
+                vertices[o.firstVertex + k] += offset;
+        }
+        o.boundsMin += offset;
+        o.boundsMax += offset;
+        refit = true;
+    }
+
+    const Obstacle &get(size_t id) const
+    {
+        return obstacles[id];
+    }
+
+    size_t size() const
+    {
+        return obstacles.size();
+    }
+
+    bool empty() const
+    {
+        return obstacles.empty();
+    }
+
+    void clear()
+    {
+        obstacles.clear();
+        vertices.clear();
+        nodes.clear();
+        order.clear();
+        rebuild = false;
+        refit = false;
+    }
+
+    // Calls visit(id) for every obstacle whose bounds overlap [boundsMin, boundsMax].
+    template <typename Visit>
+    void query(const glm::vec2 &boundsMin, const glm::vec2 &boundsMax, Visit &&visit)
+    {
+        prepare();
+        if (nodes.empty())
+            return;
+        stack.clear();
+        stack.push_back(0);
+        while (!stack.empty())
+        {
+            const Node &node = nodes[stack.back()];
+            stack.pop_back();
+            if (!overlaps(node.boundsMin, node.boundsMax, boundsMin, boundsMax))
+                continue;
+            if (node.left >= 0)
+            {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+                continue;
+            }
+            for (size_t k = 0; k < node.count; k++)
+            {
+                size_t id = order[node.first + k];
+                if (overlaps(obstacles[id].boundsMin, obstacles[id].boundsMax, boundsMin, boundsMax))
+                    visit(id);
+            }
+        }
+    }
+
+    // Displacement that takes a circle at p out of obstacle id; false if they do not touch.
+    bool resolve(size_t id, const glm::vec2 &p, float radius, glm::vec2 &push) const
+    {
+        const Obstacle &o = obstacles[id];
+        if (o.kind == Obstacle::Kind::Capsule)
+            return pushFromCapsule(o, p, radius, push);
+        return pushFromPolygon(o, p, radius, push);
+    }
+};
@@ -2,21 +2,38 @@
 #include <glm/glm.hpp>
 #include <memory>
 #include <gl_base/transform.h>
+#include "bodyStore.h"
 
 class PhysicsBody;
 using PhysicsBodyPtr = std::shared_ptr<PhysicsBody>;
 
+// Handle to a body living in a BodyStore. A new body owns a store of its own
+// until Engine::addBody moves its state into the engine's contiguous arrays.
 class PhysicsBody
 {
 private:
-    glm::vec2 positionOld;
-    glm::vec2 positionCurrent;
-    glm::vec2 acceleration;
-    float radius;
-    transform::TransformPtr nodeTransform;
+    BodyStorePtr store;
+    size_t index;
+
+    // Pooled handles are created and recycled by the Engine and have no store while parked.
+    friend class Engine;
+    PhysicsBody() : index(0) {}
 
     PhysicsBody(const glm::vec2 &oldPosition, const glm::vec2 &initialPosition, transform::TransformPtr nodeTransform, float radius)
-        : positionOld(oldPosition), positionCurrent(initialPosition), acceleration(0.0f, 0.0f), radius(radius), nodeTransform(nodeTransform) {}
+        : store(BodyStore::Make())
+    {
+        index = store->add(oldPosition, initialPosition, glm::vec2(0.0f, 0.0f), radius, nodeTransform);
+    }
+
+    glm::vec2 getOldPosition() const
+    {
+        return glm::vec2(store->oldX[index], store->oldY[index]);
+    }
+
+    glm::vec2 getAcceleration() const
+    {
+        return glm::vec2(store->ax[index], store->ay[index]);
+    }
 
 public:
     static PhysicsBodyPtr Make(const glm::vec2 &initialPosition, transform::TransformPtr nodeTransform, float radius = 1.0f)
@@ -29,55 +46,120 @@ public:
         return PhysicsBodyPtr(new PhysicsBody(oldPosition, initialPosition, nodeTransform, radius));
     }
 
+    // Copies this body's state into target and makes the handle point there.
+    void attach(BodyStorePtr target)
+    {
+        if (target == store) return;
+        size_t newIndex = target->add(getOldPosition(), getPosition(), getAcceleration(), getRadius(), getNodeTransform());
+        target->copyMaterial(newIndex, *store, index);
+        store = target;
+        index = newIndex;
+    }
+
+    // Gives the body back a private store, so it stays valid after the engine drops its arrays.
+    void detach()
+    {
+        attach(BodyStore::Make());
+    }
+
+    size_t getIndex() const
+    {
+        return index;
+    }
+
     void setNodeTransform(transform::TransformPtr t)
     {
-        nodeTransform = t;
+        store->transforms[index] = t;
+        store->syncedX[index] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    transform::TransformPtr getNodeTransform() const
+    {
+        return store->transforms[index];
     }
 
     void calculateNextPosition(float deltaTime)
     {
-        glm::vec2 velocity = positionCurrent - positionOld;
-        positionOld = positionCurrent;
-        positionCurrent += velocity + acceleration * deltaTime * deltaTime;
-        acceleration = glm::vec2(0.0f, 0.0f);
+        BodyStore &s = *store;
+        glm::vec2 positionCurrent(s.x[index], s.y[index]);
+        glm::vec2 velocity = positionCurrent - getOldPosition();
+        positionCurrent += velocity + getAcceleration() * deltaTime * deltaTime;
+        s.oldX[index] = s.x[index];
+        s.oldY[index] = s.y[index];
+        s.x[index] = positionCurrent.x;
+        s.y[index] = positionCurrent.y;
+        s.ax[index] = 0.0f;
+        s.ay[index] = 0.0f;
 
         // Atualiza o transform do nó, se existir
-        if (nodeTransform)
-        {
-            nodeTransform->setTranslate(positionCurrent.x, positionCurrent.y, 0.0f);
-        }
+        update();
     }
 
     void accelerate(const glm::vec2 &accel)
     {
-        acceleration += accel;
+        store->ax[index] += accel.x;
+        store->ay[index] += accel.y;
+        store->wake(index);
     }
     glm::vec2 getPosition() const
     {
-        return positionCurrent;
+        return glm::vec2(store->x[index], store->y[index]);
     }
     float getRadius() const
     {
-        return radius;
+        return store->r[index];
     }
     void setRadius(float radius)
     {
-        this->radius = radius;
+        store->r[index] = radius;
+    }
+    // 0 or less gives an immovable body: contacts and constraints push only the other side.
+    void setMass(float mass)
+    {
+        store->invMass[index] = mass > 0.0f ? 1.0f / mass : 0.0f;
+    }
+    float getMass() const
+    {
+        float invMass = store->invMass[index];
+        return invMass > 0.0f ? 1.0f / invMass : 0.0f;
+    }
+    // 0 keeps contacts inelastic, 1 bounces back at full speed.
+    void setRestitution(float restitution)
+    {
+        store->restitution[index] = restitution;
+    }
+    float getRestitution() const
+    {
+        return store->restitution[index];
+    }
+    // Coulomb coefficient for sliding contacts.
+    void setFriction(float friction)
+    {
+        store->friction[index] = friction;
+    }
+    float getFriction() const
+    {
+        return store->friction[index];
     }
     void move(const glm::vec2 &newPosition)
     {
-        positionCurrent += newPosition;
-        positionOld += newPosition;
+        store->x[index] += newPosition.x;
+        store->y[index] += newPosition.y;
+        store->oldX[index] += newPosition.x;
+        store->oldY[index] += newPosition.y;
+        store->wake(index);
     }
     void moveRigid(const glm::vec2 &newPosition)
     {
-        positionCurrent += newPosition;
-        // positionOld += newPosition;
+        store->x[index] += newPosition.x;
+        store->y[index] += newPosition.y;
+        store->wake(index);
+    }
+    bool isSleeping() const
+    {
+        return store->awake[index] == 0.0f;
     }
     void update() {
-        if (nodeTransform)
-        {
-            nodeTransform->setTranslate(positionCurrent.x, positionCurrent.y, 0.0f);
-        }
+        store->syncTransform(index);
     }
-};
\ No newline at end of file
+};
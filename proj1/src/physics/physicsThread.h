@@ -0,0 +1,158 @@
+#pragma once
+#include "engine.h"
+#include "tripleBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PhysicsThread;
+using PhysicsThreadPtr = std::shared_ptr<PhysicsThread>;
+
+// Copy of the body state after one fixed step, as published to the render
+// thread. Field names match BodyStore, so packCircleInstances reads either.
+struct PhysicsSnapshot
+{
+    std::vector<float> x, y;
+    std::vector<float> prevX, prevY;
+    std::vector<float> r;
+    std::vector<float> awake;
+    uint64_t step = 0;
+    std::chrono::steady_clock::time_point time; // when the step was published
+
+    size_t size() const
+    {
+        return x.size();
+    }
+};
+
+// Runs an Engine at a fixed rate on a worker thread. The render thread reads
+// the latest state through a triple buffer and never waits on the physics;
+// anything that changes the engine (spawns, clears, recording) is queued with
+// submit() and applied by the worker before its next step.
+// Once started, the Engine must only be touched from submitted commands.
+class PhysicsThread
+{
+public:
+    using Command = std::function<void(Engine &)>;
+
+private:
+    EnginePtr engine;
+    double fixedStep;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    TripleBuffer<PhysicsSnapshot> snapshots;
+
+    std::mutex commandMutex;
+    std::vector<Command> pending; // filled by submit()
+    std::vector<Command> applying; // drained by the worker
+
+    PhysicsThread(EnginePtr engine, double fixedStep) : engine(engine), fixedStep(fixedStep) {}
+
+    void applyCommands()
+    {
+        {
+            std::lock_guard<std::mutex> lock(commandMutex);
+            applying.swap(pending);
+        }
+        for (auto &command : applying)
+        {
+            command(*engine);
+        }
+        applying.clear();
+    }
+
+    void publish(uint64_t step)
+    {
+        const BodyStore &bodies = engine->getBodyStore();
+        PhysicsSnapshot &snapshot = snapshots.writeSlot();
+        snapshot.x.assign(bodies.x.begin(), bodies.x.end());
+        snapshot.y.assign(bodies.y.begin(), bodies.y.end());
+        snapshot.prevX.assign(bodies.prevX.begin(), bodies.prevX.end());
+        snapshot.prevY.assign(bodies.prevY.begin(), bodies.prevY.end());
+        snapshot.r.assign(bodies.r.begin(), bodies.r.end());
+        snapshot.awake.assign(bodies.awake.begin(), bodies.awake.end());
+        snapshot.step = step;
+        snapshot.time = std::chrono::steady_clock::now();
+        snapshots.publish();
+    }
+
+    void run()
+    {
+        using clock = std::chrono::steady_clock;
+        const auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(fixedStep));
+        // After a long stall, drop the missed steps instead of running them back to back.
+        const int maxCatchUp = 5;
+
+        uint64_t count = 0;
+        auto next = clock::now();
+        while (running.load(std::memory_order_relaxed))
+        {
+            applyCommands();
+            engine->update(static_cast<float>(fixedStep));
+            publish(++count);
+
+            next += step;
+            auto now = clock::now();
+            if (now - next > step * maxCatchUp)
+                next = now;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+public:
+    static PhysicsThreadPtr Make(EnginePtr engine, double fixedStep = 1.0 / 60.0)
+    {
+        return PhysicsThreadPtr(new PhysicsThread(engine, fixedStep));
+    }
+
+    ~PhysicsThread()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        if (running.exchange(true))
+            return;
+        worker = std::thread([this] { run(); });
+    }
+
+    // Stops after the current step; queued commands that did not run yet are dropped.
+    void stop()
+    {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    // Queues a change to the engine; safe to call from any thread.
+    void submit(Command command)
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        pending.push_back(std::move(command));
+    }
+
+    // Newest published state. Render thread only; the reference stays valid until the next call.
+    const PhysicsSnapshot &latest()
+    {
+        return snapshots.read();
+    }
+
+    // How far the render clock is into the step after snapshot (0..1), for interpolation.
+    float alpha(const PhysicsSnapshot &snapshot) const
+    {
+        std::chrono::duration<double> since = std::chrono::steady_clock::now() - snapshot.time;
+        return static_cast<float>(std::min(1.0, std::max(0.0, since.count() / fixedStep)));
+    }
+};
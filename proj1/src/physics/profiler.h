@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+// Per-phase wall-clock timers for Engine::update. They are on in debug builds
+// and compile to nothing under NDEBUG unless PHYSICS_PROFILING=1 is defined.
+#ifndef PHYSICS_PROFILING
+#ifdef NDEBUG
+#define PHYSICS_PROFILING 0
+#else
+#define PHYSICS_PROFILING 1
+#endif
+#endif
+
+namespace profiler {
+
+enum class Phase
+{
+    Forces,      // force fields
+    Integrate,
+    Broadphase,  // grid build
+    Narrowphase, // pair solve, obstacles and fast-body sweeps
+    Constraints,
+    Sleep,
+    WriteBack,   // transform sync, interpolated or not
+    Count
+};
+
+inline const char *name(Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::Forces: return "forces";
+    case Phase::Integrate: return "integrate";
+    case Phase::Broadphase: return "broadphase";
+    case Phase::Narrowphase: return "narrowphase";
+    case Phase::Constraints: return "constraints";
+    case Phase::Sleep: return "sleep";
+    case Phase::WriteBack: return "writeback";
+    default: return "?";
+    }
+}
+
+// Milliseconds spent in each phase since the last clear.
+struct Times
+{
+    double ms[static_cast<size_t>(Phase::Count)] = {};
+
+    double &operator[](Phase phase)
+    {
+        return ms[static_cast<size_t>(phase)];
+    }
+
+    double operator[](Phase phase) const
+    {
+        return ms[static_cast<size_t>(phase)];
+    }
+
+    void clear()
+    {
+        for (double &value : ms) value = 0.0;
+    }
+};
+
+class ScopedTimer
+{
+private:
+    Times &times;
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScopedTimer(Times &times, Phase phase)
+        : times(times), phase(phase), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedTimer()
+    {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        times[phase] += elapsed.count();
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+};
+
+constexpr bool enabled()
+{
+    return PHYSICS_PROFILING != 0;
+}
+
+} // namespace profiler
+
+#define PHYSICS_PROFILE_JOIN2(a, b) a##b
+#define PHYSICS_PROFILE_JOIN(a, b) PHYSICS_PROFILE_JOIN2(a, b)
+
+// Times the rest of the enclosing scope into times[Phase::phase].
+#if PHYSICS_PROFILING
+#define PHYSICS_PROFILE_SCOPE(times, phase) \
+    profiler::ScopedTimer PHYSICS_PROFILE_JOIN(physicsProfileTimer, __LINE__)(times, profiler::Phase::phase)
+#else
+#define PHYSICS_PROFILE_SCOPE(times, phase) ((void)0)
+#endif
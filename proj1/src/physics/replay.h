@@ -0,0 +1,145 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ReplayLog;
+using ReplayLogPtr = std::shared_ptr<ReplayLog>;
+
+// Everything that changes an Engine from outside during a recording.
+struct ReplayEvent
+{
+    enum class Type : uint32_t
+    {
+        Step,     // update(deltaTime) at the quality it ran with
+        Spawn,    // addBody / spawnBody at (x, y), previous position (oldX, oldY), radius and material
+        Despawn,  // despawnBody of the body at index
+        Gravity,  // setGravity / multiplyGravity result in (x, y)
+        Clear,    // clearBodies
+        Material  // material of the body at index changed through its handle
+    };
+
+    Type type;
+    uint32_t index;
+    float x, y;
+    float oldX, oldY;
+    float radius;
+    float deltaTime;
+    float invMass = 1.0f;
+    float restitution = 0.0f;
+    float friction = 0.0f;
+    // Step only: the budget picks these from wall-clock time, so they are logged
+    int32_t substeps = 0;
+    int32_t solverSteps = 0;
+    int32_t sleepInterval = 0;
+};
+
+// Engine snapshot taken when recording starts, followed by the events applied after it.
+// Engine::startRecording fills it, Engine::replay plays it back without a window.
+class ReplayLog
+{
+private:
+    static constexpr uint32_t MAGIC = 0x4c525056; // "VPRL"
+    static constexpr uint32_t VERSION = 3;
+
+    ReplayLog() {}
+
+public:
+    std::vector<uint8_t> snapshot;
+    std::vector<ReplayEvent> events;
+
+    static ReplayLogPtr Make()
+    {
+        return ReplayLogPtr(new ReplayLog());
+    }
+
+    void record(const ReplayEvent &event)
+    {
+        events.push_back(event);
+    }
+
+    size_t getStepCount() const
+    {
+        size_t steps = 0;
+        for (const auto &event : events)
+        {
+            if (event.type == ReplayEvent::Type::Step)
+                steps++;
+        }
+        return steps;
+    }
+
+    // Native byte order; logs are meant to be replayed on the same kind of machine.
+    bool save(const std::string &path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Could not open replay file for writing: " << path << std::endl;
+            return false;
+        }
+        uint64_t snapshotSize = snapshot.size();
+        uint64_t eventCount = events.size();
+        file.write(reinterpret_cast<const char *>(&MAGIC), sizeof(MAGIC));
+        file.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+        file.write(reinterpret_cast<const char *>(&snapshotSize), sizeof(snapshotSize));
+        file.write(reinterpret_cast<const char *>(snapshot.data()), snapshotSize);
+        file.write(reinterpret_cast<const char *>(&eventCount), sizeof(eventCount));
+        file.write(reinterpret_cast<const char *>(events.data()), eventCount * sizeof(ReplayEvent));
+        return static_cast<bool>(file);
+    }
+
+    static ReplayLogPtr load(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Could not open replay file: " << path << std::endl;
+            return nullptr;
+        }
+        uint32_t magic = 0, version = 0;
+        uint64_t snapshotSize = 0, eventCount = 0;
+        file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+        file.read(reinterpret_cast<char *>(&version), sizeof(version));
+        if (!file || magic != MAGIC || version != VERSION)
+        {
+            std::cerr << "Not a replay file (or unsupported version): " << path << std::endl;
+            return nullptr;
+        }
+
+        // Sizes come from the file, so they are checked against what is left of
+        // it before anything is allocated.
+        const std::streampos start = file.tellg();
+        file.seekg(0, std::ios::end);
+        const uint64_t length = static_cast<uint64_t>(file.tellg());
+        file.seekg(start);
+        auto remaining = [&]() -> uint64_t {
+            std::streampos at = file.tellg();
+            return at < 0 ? 0 : length - static_cast<uint64_t>(at);
+        };
+        auto truncated = [&]() -> ReplayLogPtr {
+            std::cerr << "Truncated replay file: " << path << std::endl;
+            return nullptr;
+        };
+
+        ReplayLogPtr log = ReplayLog::Make();
+        file.read(reinterpret_cast<char *>(&snapshotSize), sizeof(snapshotSize));
+        if (!file || snapshotSize > remaining())
+            return truncated();
+        log->snapshot.resize(snapshotSize);
+        file.read(reinterpret_cast<char *>(log->snapshot.data()), snapshotSize);
+        file.read(reinterpret_cast<char *>(&eventCount), sizeof(eventCount));
+        if (!file || eventCount > UINT64_MAX / sizeof(ReplayEvent) || eventCount * sizeof(ReplayEvent) > remaining())
+            return truncated();
+        log->events.resize(eventCount);
+        file.read(reinterpret_cast<char *>(log->events.data()), eventCount * sizeof(ReplayEvent));
+        if (!file)
+            return truncated();
+        return log;
+    }
+};
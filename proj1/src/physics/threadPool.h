@@ -0,0 +1,89 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fixed-size pool used by the Engine to run solver tasks.
+// run() hands out task indices [0, count) to the workers and blocks until all finish.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)> *job = nullptr;
+    int jobCount = 0;
+    int nextJob = 0;
+    int finished = 0;
+    bool stopping = false;
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this] { return stopping || nextJob < jobCount; });
+            if (stopping)
+                return;
+
+            int task = nextJob++;
+            const std::function<void(int)> &fn = *job;
+            lock.unlock();
+            fn(task);
+            lock.lock();
+
+            if (++finished == jobCount)
+                done.notify_one();
+        }
+    }
+
+public:
+    explicit ThreadPool(int threadCount)
+    {
+        for (int i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const
+    {
+        return static_cast<int>(workers.size());
+    }
+
+    void run(int count, const std::function<void(int)> &fn)
+    {
+        if (count <= 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        nextJob = 0;
+        finished = 0;
+        wake.notify_all();
+        done.wait(lock, [this] { return finished == jobCount; });
+        jobCount = 0;
+        nextJob = 0;
+        job = nullptr;
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single-producer, single-consumer triple buffer. The writer fills its back
+// slot and publishes it; the reader always gets the newest published slot.
+// Neither side ever waits for the other: they only swap slot indices through
+// one atomic, so a slot is never touched by both threads at once.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4; // the shared slot holds data the reader has not taken
+
+    T slots[3];
+    std::atomic<uint8_t> shared{1};
+    uint8_t back = 0;  // owned by the writer
+    uint8_t front = 2; // owned by the reader
+
+public:
+    // Writer side: the slot to fill before publish().
+    T &writeSlot()
+    {
+        return slots[back];
+    }
+
+    void publish()
+    {
+        uint8_t previous = shared.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX;
+    }
+
+    // Reader side: the newest published value. It stays valid and unchanged
+    // until the next call to read().
+    const T &read()
+    {
+        if (shared.load(std::memory_order_acquire) & FRESH)
+        {
+            uint8_t previous = shared.exchange(front, std::memory_order_acq_rel);
+            front = previous & INDEX;
+        }
+        return slots[front];
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <glad/gl.h>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "physics/engine.h"
+#include "physics/instancePacking.h"
+#include "physics/physicsThread.h"
+
+class PhysicsInstancedRenderer;
+using PhysicsInstancedRendererPtr = std::shared_ptr<PhysicsInstancedRenderer>;
+
+// Draws every body of an Engine with one instanced call: a unit circle mesh
+// plus a per-instance buffer filled straight from the body arrays, instead
+// of one scene node and one draw call per body.
+class PhysicsInstancedRenderer
+{
+private:
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint meshVbo = 0;
+    GLuint instanceVbo = 0;
+    GLsizei meshVertices = 0;
+    GLsizeiptr instanceCapacity = 0; // bytes allocated in instanceVbo
+    std::vector<CircleInstance> instances;
+
+    static std::string readFile(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cerr << "Could not open shader file: " << path << std::endl;
+            return "";
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    static GLuint compile(GLenum type, const std::string &path)
+    {
+        std::string source = readFile(path);
+        const char *text = source.c_str();
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+
+        GLint ok = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (!ok)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cerr << "Shader compile error in " << path << ": " << log << std::endl;
+        }
+        return shader;
+    }
+
+    PhysicsInstancedRenderer(const std::string &vertexPath, const std::string &fragmentPath, int segments)
+    {
+        GLuint vertex = compile(GL_VERTEX_SHADER, vertexPath);
+        GLuint fragment = compile(GL_FRAGMENT_SHADER, fragmentPath);
+        program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        GLint ok = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &ok);
+        if (!ok)
+        {
+            char log[1024];
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cerr << "Shader link error: " << log << std::endl;
+        }
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+
+        // Unit circle as a triangle fan: center, then the rim closed on itself.
+        std::vector<float> mesh = {0.0f, 0.0f};
+        for (int k = 0; k <= segments; k++)
+        {
+            float angle = 2.0f * static_cast<float>(M_PI) * k / segments;
+            mesh.push_back(std::cos(angle));
+            mesh.push_back(std::sin(angle));
+        }
+        meshVertices = static_cast<GLsizei>(mesh.size() / 2);
+
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+
+        glGenBuffers(1, &meshVbo);
+        glBindBuffer(GL_ARRAY_BUFFER, meshVbo);
+        glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(float), mesh.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+
+        glGenBuffers(1, &instanceVbo);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (void *)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+
+        glBindVertexArray(0);
+    }
+
+public:
+    static PhysicsInstancedRendererPtr Make(const std::string &vertexPath, const std::string &fragmentPath, int segments = 32)
+    {
+        return PhysicsInstancedRendererPtr(new PhysicsInstancedRenderer(vertexPath, fragmentPath, segments));
+    }
+
+    ~PhysicsInstancedRenderer()
+    {
+        glDeleteBuffers(1, &instanceVbo);
+        glDeleteBuffers(1, &meshVbo);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteProgram(program);
+    }
+
+    // Packs the engine's bodies (blended by alpha) and draws them all at once.
+    void draw(const Engine &engine, float alpha)
+    {
+        drawBodies(engine.getBodyStore(), alpha);
+    }
+
+    // Same, from a snapshot published by a PhysicsThread.
+    void draw(const PhysicsSnapshot &snapshot, float alpha)
+    {
+        drawBodies(snapshot, alpha);
+    }
+
+private:
+    template <typename Bodies>
+    void drawBodies(const Bodies &bodies, float alpha)
+    {
+        size_t count = packCircleInstances(bodies, alpha, instances);
+        if (count == 0)
+            return;
+
+        GLsizeiptr bytes = static_cast<GLsizeiptr>(count * sizeof(CircleInstance));
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+        if (bytes > instanceCapacity)
+        {
+            instanceCapacity = bytes * 2;
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity, nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances.data());
+
+        glUseProgram(program);
+        glBindVertexArray(vao);
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, meshVertices, static_cast<GLsizei>(count));
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+};
@@ -0,0 +1,448 @@
+// Headless benchmark for the physics Engine: builds seeded scenes, runs a fixed
+// number of steps and reports throughput, so regressions can be tracked between commits.
+//
+// Usage: PhysicsBenchmark [--scene pile|box|rain|funnel|cloth|fields|all] [--bodies N] [--steps N]
+//                         [--seed N] [--substeps N] [--threads N] [--continuous]
+//                         [--budget MS] [--materials] [--json]
+//        PhysicsBenchmark --replay FILE [--threads N]
+//
+// --materials gives every body a random mass, restitution and friction, to
+// compare against the default uniform solver on the same scene.
+// --replay plays back a log recorded in proj1 (R key) and reports per-step times.
+#include "physics/engine.h"
+#include "physics/physicsBody.h"
+#include "physics/instancePacking.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchmarkConfig
+{
+    std::string scene = "all";
+    int bodies = 2000;
+    int steps = 300;
+    unsigned int seed = 1761;
+    int substeps = 5;
+    int threads = 1;
+    bool json = false;
+    bool continuous = false;
+    bool materials = false;
+    float budget = 0.0f;
+    std::string replay;
+};
+
+struct BenchmarkResult
+{
+    std::string scene;
+    size_t bodies = 0;      // at the end of the run
+    uint64_t bodySteps = 0; // bodies summed over every step, as the count can change during a run
+    int steps = 0;
+    double seconds = 0.0;
+    uint64_t pairTests = 0;
+    uint64_t contacts = 0;
+    float maxPenetration = 0.0f;
+    profiler::Times profile;
+    EngineQuality quality; // after the last step
+    double packNsPerBody = 0.0; // PhysicsInstancedRenderer's per-frame instance packing
+};
+
+static const float FIXED_STEP = 1.0f / 60.0f;
+
+// Scene builders. Each returns an engine and a per-step spawn callback (may do nothing).
+struct Scene
+{
+    EnginePtr engine;
+    std::function<void(int step)> spawn = [](int) {};
+};
+
+// Bodies laid out on a loose lattice above the floor, all falling at once.
+static Scene makePile(const BenchmarkConfig &config, std::mt19937 &gen)
+{
+    Scene scene;
+    const float radius = 0.02f;
+    const float width = std::max(2.0f, std::sqrt(static_cast<float>(config.bodies)) * radius * 3.0f);
+    scene.engine = Engine::make(-width * 0.5f, width * 0.5f, -1.0f, 1000.0f, glm::vec2(0.0f, -2.0f), config.substeps);
+
+    std::uniform_real_distribution<float> jitter(-0.2f * radius, 0.2f * radius);
+    const int perRow = static_cast<int>(width / (radius * 3.0f));
+    for (int i = 0; i < config.bodies; i++)
+    {
+        float x = -width * 0.5f + radius * 1.5f + (i % perRow) * radius * 3.0f + jitter(gen);
+        float y = -1.0f + radius * 1.5f + (i / perRow) * radius * 3.0f;
+        scene.engine->addBody(PhysicsBody::Make(glm::vec2(x, y), nullptr, radius));
+    }
+    return scene;
+}
+
+// Closed box packed with touching bodies, so every step is contact-heavy.
+static Scene makeBox(const BenchmarkConfig &config, std::mt19937 &gen)
+{
+    Scene scene;
+    const int perRow = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(config.bodies))));
+    const float radius = 1.0f / perRow;
+    scene.engine = Engine::make(-1.0f, 1.0f, -1.0f, 1.0f, glm::vec2(0.0f, -2.0f), config.substeps);
+
+    std::uniform_real_distribution<float> kick(-0.1f * radius, 0.1f * radius);
+    for (int i = 0; i < config.bodies; i++)
+    {
+        glm::vec2 pos(-1.0f + radius + (i % perRow) * 2.0f * radius,
+                      -1.0f + radius + (i / perRow) * 2.0f * radius);
+        glm::vec2 old = pos + glm::vec2(kick(gen), kick(gen));
+        scene.engine->addBody(PhysicsBody::Make(old, pos, nullptr, radius));
+    }
+    return scene;
+}
+
+// Bodies with proj1's radii(0.03, 0.3) spawned from the top a few per step.
+static Scene makeRain(const BenchmarkConfig &config, std::mt19937 &gen)
+{
+    Scene scene;
+    // Mean circle area for r ~ U(0.03, 0.3) is about 0.105; keep the filled area near 40%.
+    const float width = std::max(2.0f, std::sqrt(config.bodies * 0.105f / 0.4f));
+    scene.engine = Engine::make(-width * 0.5f, width * 0.5f, -1.0f, 1000.0f, glm::vec2(0.0f, -2.0f), config.substeps);
+
+    const int perStep = std::max(1, config.bodies / std::max(1, config.steps / 2));
+    auto spawned = std::make_shared<int>(0);
+    Engine *engine = scene.engine.get();
+    scene.spawn = [engine, &gen, spawned, perStep, width, &config](int) {
+        std::uniform_real_distribution<float> distr(-width * 0.5f + 0.3f, width * 0.5f - 0.3f);
+        std::uniform_real_distribution<float> radii(0.03f, 0.3f);
+        for (int k = 0; k < perStep && *spawned < config.bodies; k++, (*spawned)++)
+        {
+            glm::vec2 pos(distr(gen), width + 1.0f);
+            engine->addBody(PhysicsBody::Make(pos, nullptr, radii(gen)));
+        }
+    };
+    return scene;
+}
+
+// Rain poured into a funnel of segments over a row of polygon pegs and capsules.
+static Scene makeFunnel(const BenchmarkConfig &config, std::mt19937 &gen)
+{
+    Scene scene = makeRain(config, gen);
+    Engine &engine = *scene.engine;
+    const float width = std::max(2.0f, std::sqrt(config.bodies * 0.105f / 0.4f));
+    const float half = width * 0.5f;
+
+    engine.addSegment(glm::vec2(-half, width * 0.6f), glm::vec2(-0.4f, width * 0.3f));
+    engine.addSegment(glm::vec2(half, width * 0.6f), glm::vec2(0.4f, width * 0.3f));
+    for (float x = -half + 0.5f; x < half - 0.5f; x += 1.0f)
+    {
+        engine.addPolygon({glm::vec2(x - 0.15f, 0.0f), glm::vec2(x + 0.15f, 0.0f), glm::vec2(x, 0.25f)});
+        engine.addCapsule(glm::vec2(x + 0.3f, width * 0.15f), glm::vec2(x + 0.6f, width * 0.12f), 0.05f);
+    }
+    return scene;
+}
+
+// A square cloth of linked bodies hanging from pins on its top row.
+static Scene makeCloth(const BenchmarkConfig &config, std::mt19937 &)
+{
+    Scene scene;
+    const int side = std::max(2, static_cast<int>(std::sqrt(static_cast<float>(config.bodies))));
+    const float spacing = 2.0f / side;
+    scene.engine = Engine::make(-2.0f, 2.0f, -2.0f, 1000.0f, glm::vec2(0.0f, -2.0f), config.substeps);
+    Engine &engine = *scene.engine;
+
+    std::vector<PhysicsBodyPtr> nodes;
+    nodes.reserve(side * side);
+    for (int row = 0; row < side; row++)
+    {
+        for (int col = 0; col < side; col++)
+        {
+            // Sideways offset so the cloth swings instead of hanging still.
+            glm::vec2 pos(-1.0f + col * spacing + row * spacing * 0.3f, 1.5f - row * spacing * 0.9f);
+            nodes.push_back(PhysicsBody::Make(pos, nullptr, spacing * 0.3f));
+            engine.addBody(nodes.back());
+        }
+    }
+    for (int row = 0; row < side; row++)
+    {
+        for (int col = 0; col < side; col++)
+        {
+            const PhysicsBodyPtr &node = nodes[row * side + col];
+            if (col + 1 < side) engine.addLink(node, nodes[row * side + col + 1], 1.0f, spacing);
+            if (row + 1 < side) engine.addLink(node, nodes[(row + 1) * side + col], 1.0f, spacing);
+        }
+    }
+    for (int col = 0; col < side; col += std::max(1, side / 8))
+    {
+        engine.pinBody(nodes[col]);
+    }
+    return scene;
+}
+
+// Rain stirred by 48 small attractors, repulsors, vortices and drag pools.
+static Scene makeFields(const BenchmarkConfig &config, std::mt19937 &gen)
+{
+    Scene scene = makeRain(config, gen);
+    Engine &engine = *scene.engine;
+    const float width = std::max(2.0f, std::sqrt(config.bodies * 0.105f / 0.4f));
+
+    std::uniform_real_distribution<float> across(-width * 0.5f, width * 0.5f);
+    std::uniform_real_distribution<float> height(-1.0f, width);
+    const ForceFieldKind kinds[] = {ForceFieldKind::Attractor, ForceFieldKind::Repulsor, ForceFieldKind::Vortex, ForceFieldKind::Drag};
+    for (int k = 0; k < 48; k++)
+    {
+        ForceFieldKind kind = kinds[k % 4];
+        engine.addForceField(kind, glm::vec2(across(gen), height(gen)), width * 0.08f, kind == ForceFieldKind::Drag ? 2.0f : 4.0f);
+    }
+    return scene;
+}
+
+static BenchmarkResult runScene(const std::string &name, const BenchmarkConfig &config)
+{
+    std::mt19937 gen(config.seed);
+    Scene scene = name == "pile" ? makePile(config, gen)
+                : name == "box"  ? makeBox(config, gen)
+                : name == "rain" ? makeRain(config, gen)
+                : name == "funnel" ? makeFunnel(config, gen)
+                : name == "cloth" ? makeCloth(config, gen)
+                                 : makeFields(config, gen);
+    scene.engine->setSolverThreads(config.threads);
+    scene.engine->setContinuousCollision(config.continuous);
+    scene.engine->setTimeBudget(config.budget);
+
+    BenchmarkResult result;
+    result.scene = name;
+    result.steps = config.steps;
+
+    // Separate generator, so the scene itself is the same with and without --materials.
+    std::mt19937 materialGen(config.seed + 1);
+    std::uniform_real_distribution<float> masses(0.5f, 2.0f);
+    std::uniform_real_distribution<float> coefficients(0.0f, 0.5f);
+    size_t withMaterial = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < config.steps; step++)
+    {
+        scene.spawn(step);
+        for (; config.materials && withMaterial < scene.engine->getBodyCount(); withMaterial++)
+        {
+            PhysicsBodyPtr body = scene.engine->getBody(withMaterial);
+            body->setMass(masses(materialGen));
+            body->setRestitution(coefficients(materialGen));
+            body->setFriction(coefficients(materialGen));
+        }
+        result.bodySteps += scene.engine->getBodyCount();
+        scene.engine->update(FIXED_STEP);
+        const EngineStats &stats = scene.engine->getStats();
+        result.pairTests += stats.pairTests;
+        result.contacts += stats.contacts;
+        result.maxPenetration = std::max(result.maxPenetration, stats.maxPenetration);
+        for (size_t p = 0; p < static_cast<size_t>(profiler::Phase::Count); p++)
+        {
+            result.profile.ms[p] += scene.engine->getProfile().ms[p];
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    result.seconds = elapsed.count();
+    result.bodies = scene.engine->getBodyCount();
+    result.quality = scene.engine->getQuality();
+
+    // The renderer packs once per frame; time it on the final state.
+    const int packRuns = 50;
+    std::vector<CircleInstance> instances;
+    auto packStart = std::chrono::steady_clock::now();
+    for (int run = 0; run < packRuns; run++)
+    {
+        packCircleInstances(scene.engine->getBodyStore(), 0.5f, instances);
+    }
+    std::chrono::duration<double> packElapsed = std::chrono::steady_clock::now() - packStart;
+    result.packNsPerBody = packElapsed.count() * 1.0e9 / (static_cast<double>(packRuns) * std::max<size_t>(1, result.bodies));
+    return result;
+}
+
+static double nsPerBodyStep(const BenchmarkResult &r)
+{
+    return r.seconds * 1.0e9 / static_cast<double>(std::max<uint64_t>(1, r.bodySteps));
+}
+
+// Replays a recorded session and prints the step time distribution and the slowest steps.
+static int runReplay(const BenchmarkConfig &config)
+{
+    ReplayLogPtr log = ReplayLog::load(config.replay);
+    if (!log)
+        return 1;
+
+    EnginePtr engine = Engine::make();
+    engine->setSolverThreads(config.threads);
+
+    std::vector<std::pair<double, size_t>> times;
+    times.reserve(log->getStepCount());
+    if (!engine->replay(*log, [&](size_t step, double ms) { times.push_back({ms, step}); }))
+        return 1;
+    if (times.empty())
+    {
+        std::cout << "No steps in " << config.replay << std::endl;
+        return 0;
+    }
+
+    double total = 0.0;
+    for (const auto &t : times) total += t.first;
+    std::sort(times.begin(), times.end(), std::greater<std::pair<double, size_t>>());
+
+    std::cout << std::fixed << std::setprecision(3)
+              << times.size() << " steps, " << engine->getBodyCount() << " bodies at the end" << std::endl
+              << "mean " << total / times.size() << " ms, median " << times[times.size() / 2].first
+              << " ms, max " << times.front().first << " ms" << std::endl
+              << "slowest steps:" << std::endl;
+    for (size_t i = 0; i < std::min<size_t>(10, times.size()); i++)
+    {
+        std::cout << "  step " << times[i].second << ": " << times[i].first << " ms" << std::endl;
+    }
+    return 0;
+}
+
+static bool parseArgs(int argc, char **argv, BenchmarkConfig &config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json") config.json = true;
+        else if (arg == "--continuous") config.continuous = true;
+        else if (arg == "--materials") config.materials = true;
+        else if (arg == "--budget" && hasValue) config.budget = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--scene" && hasValue) config.scene = argv[++i];
+        else if (arg == "--bodies" && hasValue) config.bodies = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--steps" && hasValue) config.steps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--substeps" && hasValue) config.substeps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) config.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--replay" && hasValue) config.replay = argv[++i];
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (config.scene != "all" && config.scene != "pile" && config.scene != "box" && config.scene != "rain" &&
+        config.scene != "funnel" && config.scene != "cloth" &&
+        config.scene != "fields")
+    {
+        std::cerr << "Unknown scene: " << config.scene << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkConfig config;
+    if (!parseArgs(argc, argv, config))
+        return 1;
+    if (!config.replay.empty())
+        return runReplay(config);
+
+    std::vector<std::string> scenes;
+    if (config.scene == "all") scenes = {"pile", "box", "rain", "funnel", "cloth", "fields"};
+    else scenes = {config.scene};
+
+    std::vector<BenchmarkResult> results;
+    for (const auto &name : scenes)
+    {
+        results.push_back(runScene(name, config));
+    }
+
+    const char *kernel = integrator::name(integrator::detect());
+    if (config.json)
+    {
+        std::cout << "{\"seed\": " << config.seed
+                  << ", \"substeps\": " << config.substeps
+                  << ", \"threads\": " << config.threads
+                  << ", \"materials\": " << (config.materials ? "true" : "false")
+                  << ", \"integrator\": \"" << kernel << "\", \"results\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchmarkResult &r = results[i];
+            std::cout << (i ? ", " : "") << "{\"scene\": \"" << r.scene << "\""
+                      << ", \"bodies\": " << r.bodies
+                      << ", \"steps\": " << r.steps
+                      << ", \"seconds\": " << r.seconds
+                      << ", \"steps_per_sec\": " << r.steps / r.seconds
+                      << ", \"ns_per_body_step\": " << nsPerBodyStep(r)
+                      << ", \"pair_tests\": " << r.pairTests
+                      << ", \"contacts\": " << r.contacts
+                      << ", \"max_penetration\": " << r.maxPenetration
+                      << ", \"quality_level\": " << r.quality.level
+                      << ", \"pack_ns_per_body\": " << r.packNsPerBody;
+            if (profiler::enabled())
+            {
+                std::cout << ", \"ms_per_step\": {";
+                for (size_t p = 0; p < static_cast<size_t>(profiler::Phase::Count); p++)
+                {
+                    std::cout << (p ? ", " : "") << "\"" << profiler::name(static_cast<profiler::Phase>(p)) << "\": "
+                              << r.profile.ms[p] / r.steps;
+                }
+                std::cout << "}";
+            }
+            std::cout << "}";
+        }
+        std::cout << "]}" << std::endl;
+        return 0;
+    }
+
+    std::cout << "seed " << config.seed << ", " << config.substeps << " substeps, "
+              << config.threads << " thread(s), " << kernel << " integrator"
+              << (config.materials ? ", per-body materials" : "") << std::endl;
+    std::cout << std::left << std::setw(8) << "scene"
+              << std::setw(10) << "bodies"
+              << std::setw(14) << "steps/sec"
+              << std::setw(18) << "ns/body/step"
+              << std::setw(18) << "pair tests/step"
+              << std::setw(16) << "contacts/step"
+              << std::setw(17) << "max penetration"
+              << "pack ns/body" << std::endl;
+    for (const auto &r : results)
+    {
+        std::cout << std::left << std::setw(8) << r.scene
+                  << std::setw(10) << r.bodies
+                  << std::setw(14) << std::fixed << std::setprecision(1) << r.steps / r.seconds
+                  << std::setw(18) << nsPerBodyStep(r)
+                  << std::setw(18) << std::setprecision(0) << static_cast<double>(r.pairTests) / r.steps
+                  << std::setw(16) << static_cast<double>(r.contacts) / r.steps
+                  << std::setw(17) << std::setprecision(4) << r.maxPenetration
+                  << std::setprecision(2) << r.packNsPerBody << std::endl;
+    }
+
+    if (config.budget > 0.0f)
+    {
+        std::cout << std::endl << "budget " << std::setprecision(2) << config.budget << " ms" << std::endl;
+        for (const auto &r : results)
+        {
+            std::cout << std::setw(8) << r.scene << "level " << r.quality.level
+                      << ": " << r.quality.substeps << " substeps, " << r.quality.solverSteps << " solver steps, sleep checks every "
+                      << r.quality.sleepInterval << ", last update " << std::setprecision(2) << r.quality.updateMs << " ms" << std::endl;
+        }
+    }
+
+    if (!profiler::enabled())
+        return 0;
+    std::cout << std::endl << std::left << std::setw(8) << "ms/step";
+    for (size_t p = 0; p < static_cast<size_t>(profiler::Phase::Count); p++)
+    {
+        std::cout << std::setw(13) << profiler::name(static_cast<profiler::Phase>(p));
+    }
+    std::cout << std::endl;
+    for (const auto &r : results)
+    {
+        std::cout << std::setw(8) << r.scene << std::setprecision(3);
+        for (size_t p = 0; p < static_cast<size_t>(profiler::Phase::Count); p++)
+        {
+            std::cout << std::setw(13) << r.profile.ms[p] / r.steps;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -11,19 +11,56 @@
 // <<< Include physics engine files
 #include "physics/engine.h"
 #include "physics/physicsBody.h"
+#include "physics/physicsThread.h"
+#include "physicsInstancedRenderer.h"
 
 #include <random> // For generating random positions
 
 #define BACKGROUND_COLOR 0.05f, 0.05f, 0.1f
+// 1: all circles are drawn by one instanced call; 0: one scene node per circle.
+#define INSTANCED_CIRCLES 1
+// 1: the engine steps on its own thread and the renderer reads published snapshots.
+// Needs INSTANCED_CIRCLES, since scene node transforms must not be written off the render thread.
+#define PHYSICS_THREAD 1
+
+#if PHYSICS_THREAD && !INSTANCED_CIRCLES
+#error "PHYSICS_THREAD requires INSTANCED_CIRCLES"
+#endif
+
+// Physics runs at 30 Hz now that rendering interpolates between steps. Without
+// the physics thread, the engine steps once every PHYSICS_EVERY fixed updates
+// of EnGene (60 Hz), which gives the same rate.
+const double PHYSICS_STEP = 1.0 / 30.0;
+const int PHYSICS_EVERY = 2;
 
 // <<< Declare the physics engine pointer so it can be accessed by on_init and on_update
 EnginePtr physicsEngine;
 int circle_count = 0;
 TexturedCirclePtr earth;
+PhysicsInstancedRendererPtr circleRenderer;
+PhysicsThreadPtr physicsThread;
+
+// Runs a change on the engine: queued for the physics thread when it is running, immediately otherwise.
+void withPhysics(PhysicsThread::Command command)
+{
+    if (physicsThread)
+        physicsThread->submit(std::move(command));
+    else
+        command(*physicsEngine);
+}
 
 // Function to create a circle with a physics body
 void createPhysicsCircle(const glm::vec2& initialPosition, float radius, shader::ShaderPtr shader, std::string container)
 {
+    if (INSTANCED_CIRCLES) {
+        // The instanced renderer reads positions straight from the engine, no node needed.
+        circle_count++;
+        withPhysics([initialPosition, radius](Engine &engine) {
+            engine.spawnBody(initialPosition, radius);
+        });
+        return;
+    }
+
     // 1. Create the transform that will be shared between the scene node and the physics body.
     auto circle_transform = transform::Transform::Make();
     
@@ -48,12 +85,8 @@ void createPhysicsCircle(const glm::vec2& initialPosition, float radius, shader:
 
     circle_count++;
 
-    // 3. Create the physics body.
-    // Pass the initial position, the shared transform, and the radius.
-    auto physics_body = PhysicsBody::Make(initialPosition, circle_transform, radius);
-
-    // 4. Add the new body to the engine.
-    physicsEngine->addBody(physics_body);
+    // 3. Activate a pooled physics body with the initial position, the shared transform, and the radius.
+    physicsEngine->spawnBody(initialPosition, radius, circle_transform);
 }
 
 
@@ -84,6 +117,20 @@ int main() {
         // <<< 1. Initialize the Physics Engine
         // We define the simulation area to match the typical OpenGL normalized device coordinates.
         physicsEngine = Engine::make(-1.0f, 1.0f, -1.0f, 1000.0f, glm::vec2(0.0f, -2.0f));
+        // Transforms are written in on_render, blended between the last two physics steps.
+        physicsEngine->setInterpolation(true);
+        // Circles resting on the pile stop costing integration and collision time.
+        physicsEngine->setSleeping(true);
+        // Spawning from the pool does not allocate while fewer bodies than this are alive.
+        physicsEngine->reserveBodies(256);
+        // Small circles dropped in a long frame are swept instead of raising the substep count.
+        physicsEngine->setContinuousCollision(true);
+        // Under heavy load the engine trades substeps for time instead of stalling the frame.
+        physicsEngine->setTimeBudget(8.0f);
+        if (PHYSICS_THREAD) {
+            physicsThread = PhysicsThread::Make(physicsEngine, PHYSICS_STEP);
+            physicsThread->start();
+        }
 
         // <<< 2. Create the container for the circles
         scene::graph()->addNode("container")
@@ -105,15 +152,23 @@ int main() {
                 0.5f, 0.5f,  // Texture scale/offset if needed
                 0.45f
             );
+
+        circleRenderer = PhysicsInstancedRenderer::Make(
+            "../shaders/instanced_circle_vertex.glsl",
+            "../shaders/instanced_circle_fragment.glsl"
+        );
     };
 
     double time_passed = 0;
+    int fixed_ticks = 0; // EnGene fixed updates since the last physics step
 
     // This function handles the fixed-timestep simulation logic.
     auto on_fixed_update = [&](double fixed_timestep) {
-        // Update the physics engine.
-        // This will calculate new positions based on gravity and collisions.
-        // Because we linked the transforms, the visual objects will move automatically.
+        // Spawns circles, and steps the engine when it has no thread of its own.
+        // With PHYSICS_THREAD the thread steps it and publishes each state through
+        // a triple buffer, which on_render draws as instances. Otherwise the
+        // instanced renderer reads the engine arrays directly, or, without
+        // INSTANCED_CIRCLES, on_render writes interpolated node transforms.
         
         if (circle_count < initialNumberOfCircles)
         {
@@ -125,20 +180,39 @@ int main() {
             }
         }
 
-        if(physicsEngine)
+        if(physicsEngine && !physicsThread && ++fixed_ticks == PHYSICS_EVERY)
         {
-            physicsEngine->update(static_cast<float>(fixed_timestep));
+            fixed_ticks = 0;
+            physicsEngine->update(static_cast<float>(fixed_timestep * PHYSICS_EVERY));
         }
 
     };
 
     // This function handles all rendering.
     auto on_render = [&](double alpha) {
-        // The 'alpha' parameter can be used for smooth interpolation between physics states
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // EnGene's alpha covers one fixed update; a physics step spans PHYSICS_EVERY of them.
+        alpha = (fixed_ticks + alpha) / PHYSICS_EVERY;
+
+        // Blend the last two physics states so the fixed update rate can stay low.
+        if (physicsEngine && !INSTANCED_CIRCLES)
+        {
+            physicsEngine->writeInterpolatedTransforms(static_cast<float>(alpha));
+        }
         
         // Render the scene graph with the updated positions.
         scene::graph()->draw();
+
+        if (physicsThread)
+        {
+            // Never waits on the physics thread: takes whatever step it published last.
+            const PhysicsSnapshot &snapshot = physicsThread->latest();
+            circleRenderer->draw(snapshot, physicsThread->alpha(snapshot));
+        }
+        else if (physicsEngine && INSTANCED_CIRCLES)
+        {
+            circleRenderer->draw(*physicsEngine, static_cast<float>(alpha));
+        }
         
         Error::Check("render");
     };
@@ -192,7 +266,20 @@ int main() {
             }
             else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
                 scene::graph()->clearGraph();
-                physicsEngine->clearBodies();
+                withPhysics([](Engine &engine) { engine.clearBodies(); });
+            }
+            // Toggle physics recording; replay it with PhysicsBenchmark --replay physics.replay
+            else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+                withPhysics([](Engine &engine) {
+                    ReplayLogPtr log = engine.stopRecording();
+                    if (log) {
+                        if (log->save("physics.replay"))
+                            std::cout << "Saved " << log->getStepCount() << " physics steps to physics.replay" << std::endl;
+                    } else {
+                        engine.startRecording(ReplayLog::Make());
+                        std::cout << "Recording physics" << std::endl;
+                    }
+                });
             }
         });
 
@@ -206,6 +293,9 @@ int main() {
         
         app.run();
 
+        if (physicsThread)
+            physicsThread->stop();
+
     } catch (const std::runtime_error& e) {
         std::cerr << "An error occurred: " << e.what() << std::endl;
         return -1;
@@ -131,8 +131,8 @@ class Node { // BACALHAU falta fazer as subclasses de nó
             if (shape) {
                 
                 // Envia a matriz de transformação para o shader
-                unsigned int shader_program = shaderStack().top()->GetShaderID();
-                unsigned int transformLoc = glGetUniformLocation(shader_program, "M");
+                static const UniformHandle transform_uniform = InternUniform("M");
+                int transformLoc = shaderStack().top()->GetUniformLocation(transform_uniform);
                 glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform_stack.top()));
                 shape->Draw();
             }
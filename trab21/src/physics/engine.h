@@ -1,10 +1,17 @@
 #pragma once
 #include "physicsBody.h"
+#include "collisionGrid.h"
 #include <glm/glm.hpp>
 
 class Engine;
 using EnginePtr = std::shared_ptr<Engine>;
 
+enum class Broadphase
+{
+    BruteForce, // tests every pair, kept for comparison
+    Grid
+};
+
 class Engine
 {
 private:
@@ -15,6 +22,8 @@ private:
     int solverSteps;
     bool rigid;
     std::vector<PhysicsBodyPtr> bodies;
+    Broadphase broadphase = Broadphase::Grid;
+    CollisionGrid grid;
     
     Engine(int substeps, int solverSteps = 1, bool rigid = true) : numSubsteps(substeps), solverSteps(solverSteps), rigid(rigid) {}
 
@@ -45,28 +54,40 @@ private:
     }
 
 
+    void solveCollision(size_t i, size_t j)
+    {
+        glm::vec2 posA = bodies[i]->getPosition();
+        glm::vec2 posB = bodies[j]->getPosition();
+        float distance = glm::length(posA - posB);
+        float minDistance = bodies[i]->getRadius() + bodies[j]->getRadius();
+
+        if (distance < minDistance && distance > 0.0f)
+        {
+            glm::vec2 collisionNormal = glm::normalize(posB - posA);
+            glm::vec2 correction = collisionNormal * (minDistance - distance) * 0.5f;
+
+            if (rigid) bodies[i]->moveRigid(-correction);
+            else bodies[i]->move(-correction);
+
+            if (rigid) bodies[j]->moveRigid(correction);
+            else bodies[j]->move(correction);
+        }
+    }
+
     void solveCollisions()
     {
+        if (broadphase == Broadphase::Grid)
+        {
+            grid.build(bodies, areaMin, areaMax);
+            grid.forEachPair([this](size_t i, size_t j) { solveCollision(i, j); });
+            return;
+        }
+
         for (size_t i = 0; i < bodies.size(); i++)
         {
             for (size_t j = i + 1; j < bodies.size(); j++)
             {
-                glm::vec2 posA = bodies[i]->getPosition();
-                glm::vec2 posB = bodies[j]->getPosition();
-                float distance = glm::length(posA - posB);
-                float minDistance = bodies[i]->getRadius() + bodies[j]->getRadius();
-
-                if (distance < minDistance && distance > 0.0f)
-                {
-                    glm::vec2 collisionNormal = glm::normalize(posB - posA);
-                    glm::vec2 correction = collisionNormal * (minDistance - distance) * 0.5f;
-
-                    if (rigid) bodies[i]->moveRigid(-correction);
-                    else bodies[i]->move(-correction);
-        
-                    if (rigid) bodies[j]->moveRigid(correction);
-                    else bodies[j]->move(correction);
-                }
+                solveCollision(i, j);
             }
         }
     }
@@ -129,6 +150,16 @@ public:
         }
     }
 
+    void setBroadphase(Broadphase mode)
+    {
+        broadphase = mode;
+    }
+
+    Broadphase getBroadphase() const
+    {
+        return broadphase;
+    }
+
     void multiplyGravity(float factor)
     {
         gravity *= factor;
@@ -93,6 +93,9 @@ public:
     virtual void Draw () {
         Shape::Draw();
     }
+    virtual void DrawBound () const {
+        Shape::DrawBound();
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,209 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Nomes internados e tabelas hash de endereçamento aberto para as buscas do
+// grafo de cena. O hash de cada nome é calculado uma vez, quando ele é
+// internado; depois disso um nome é só um índice inteiro.
+namespace names {
+
+struct NameHandle {
+    uint32_t id = UINT32_MAX;
+
+    bool valid() const {
+        return id != UINT32_MAX;
+    }
+
+    bool operator==(const NameHandle& other) const {
+        return id == other.id;
+    }
+
+    bool operator!=(const NameHandle& other) const {
+        return id != other.id;
+    }
+};
+
+// FNV-1a de 64 bits
+inline uint64_t hashName(const std::string& text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Mapa de chave inteira (ids de nós, ids de nomes) para V, com sondagem
+// linear numa tabela de tamanho potência de 2 e carga de no máximo 1/2.
+// A remoção desloca as entradas seguintes para trás, então não há lápides.
+template <typename V>
+class IdMap {
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<uint32_t> keys;
+    std::vector<V> values;
+    size_t count = 0;
+
+    size_t mask() const {
+        return keys.size() - 1;
+    }
+
+    // Hash de Fibonacci: espalha ids sequenciais pela tabela
+    size_t home(uint32_t key) const {
+        return static_cast<size_t>((key * 11400714819323198485ull) >> 32) & mask();
+    }
+
+    void grow() {
+        std::vector<uint32_t> old_keys;
+        std::vector<V> old_values;
+        old_keys.swap(keys);
+        old_values.swap(values);
+        size_t capacity = old_keys.empty() ? 16 : old_keys.size() * 2;
+        keys.assign(capacity, EMPTY);
+        values.assign(capacity, V());
+        count = 0;
+        for (size_t i = 0; i < old_keys.size(); i++) {
+            if (old_keys[i] != EMPTY) insert(old_keys[i], std::move(old_values[i]));
+        }
+    }
+
+public:
+    // Insere ou substitui
+    void insert(uint32_t key, V value) {
+        if ((count + 1) * 2 > keys.size()) grow();
+        size_t slot = home(key);
+        while (keys[slot] != EMPTY && keys[slot] != key) {
+            slot = (slot + 1) & mask();
+        }
+        if (keys[slot] == EMPTY) count++;
+        keys[slot] = key;
+        values[slot] = std::move(value);
+    }
+
+    // Valor da chave, ou nullptr
+    const V* find(uint32_t key) const {
+        if (keys.empty()) return nullptr;
+        size_t slot = home(key);
+        while (keys[slot] != EMPTY) {
+            if (keys[slot] == key) return &values[slot];
+            slot = (slot + 1) & mask();
+        }
+        return nullptr;
+    }
+
+    bool contains(uint32_t key) const {
+        return find(key) != nullptr;
+    }
+
+    void erase(uint32_t key) {
+        if (keys.empty()) return;
+        size_t slot = home(key);
+        while (keys[slot] != key) {
+            if (keys[slot] == EMPTY) return;
+            slot = (slot + 1) & mask();
+        }
+        // Puxa para trás as entradas cuja posição ideal não fica depois do buraco
+        size_t hole = slot;
+        size_t next = (hole + 1) & mask();
+        while (keys[next] != EMPTY) {
+            size_t ideal = home(keys[next]);
+            if (((next - ideal) & mask()) >= ((next - hole) & mask())) {
+                keys[hole] = keys[next];
+                values[hole] = std::move(values[next]);
+                hole = next;
+            }
+            next = (next + 1) & mask();
+        }
+        keys[hole] = EMPTY;
+        values[hole] = V();
+        count--;
+    }
+
+    void clear() {
+        keys.clear();
+        values.clear();
+        count = 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+};
+
+// Tabela global de nomes internados: texto e hash guardados uma vez cada, e
+// uma tabela de endereçamento aberto do hash para o id.
+class NameTable {
+private:
+    struct Entry {
+        std::string text;
+        uint64_t hash;
+    };
+
+    std::vector<Entry> entries; // indexado pelo id do NameHandle
+    std::vector<uint32_t> slots; // ids, ou UINT32_MAX se vazio
+
+    NameTable() = default;
+    friend NameTable& table();
+
+    size_t findSlot(const std::string& text, uint64_t hash) const {
+        size_t mask = slots.size() - 1;
+        size_t slot = static_cast<size_t>(hash) & mask;
+        while (slots[slot] != UINT32_MAX) {
+            const Entry& entry = entries[slots[slot]];
+            if (entry.hash == hash && entry.text == text) break;
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void grow() {
+        size_t capacity = slots.empty() ? 64 : slots.size() * 2;
+        slots.assign(capacity, UINT32_MAX);
+        for (uint32_t id = 0; id < entries.size(); id++) {
+            slots[findSlot(entries[id].text, entries[id].hash)] = id;
+        }
+    }
+
+public:
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    NameHandle intern(const std::string& text) {
+        if ((entries.size() + 1) * 2 > slots.size()) grow();
+        uint64_t hash = hashName(text);
+        size_t slot = findSlot(text, hash);
+        if (slots[slot] == UINT32_MAX) {
+            slots[slot] = entries.size();
+            entries.push_back({text, hash});
+        }
+        return NameHandle{slots[slot]};
+    }
+
+    // Handle de um nome já internado, sem internar; inválido se ele não existe
+    NameHandle find(const std::string& text) const {
+        if (slots.empty()) return NameHandle();
+        return NameHandle{slots[findSlot(text, hashName(text))]};
+    }
+
+    const std::string& text(NameHandle name) const {
+        return entries[name.id].text;
+    }
+};
+
+inline NameTable& table() {
+    static NameTable instance;
+    return instance;
+}
+
+inline NameHandle intern(const std::string& text) {
+    return table().intern(text);
+}
+
+}
+
+#endif
@@ -42,5 +42,8 @@ public:
   virtual void Draw () {
     Shape::Draw();
   }
+  virtual void DrawBound () const {
+    Shape::DrawBound();
+  }
 };
 #endif
\ No newline at end of file
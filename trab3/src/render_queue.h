@@ -0,0 +1,120 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Shape;
+class Shader;
+
+// Fila de renderização: a travessia da cena só emite pacotes, que são
+// ordenados por chave e depois enviados de uma vez com o mínimo de trocas de
+// estado. Nada aqui chama OpenGL, então montar e ordenar pacotes funciona sem
+// contexto.
+namespace render {
+
+enum class Pass : uint8_t {
+    Sorted = 0,  // ordenado por estado; só para formas com depth test ou que não se sobrepõem
+    Ordered = 1, // na ordem da travessia (algoritmo do pintor), o padrão para o 2D sem depth test
+};
+
+struct DrawPacket {
+    glm::mat4 model;
+    Shape* shape;
+    Shader* shader;
+};
+
+// Chave de 64 bits: passe (4) | shader (16) | material (12) | textura (16) | geometria (16).
+// No passe Ordered os 60 bits abaixo do passe guardam a sequência de emissão.
+inline uint64_t makeKey(Pass pass, uint32_t shader, uint32_t material, uint32_t texture, uint32_t geometry, uint32_t sequence) {
+    uint64_t key = static_cast<uint64_t>(pass) << 60;
+    if (pass == Pass::Ordered) return key | sequence;
+    return key
+        | static_cast<uint64_t>(shader & 0xFFFF) << 44
+        | static_cast<uint64_t>(material & 0xFFF) << 32
+        | static_cast<uint64_t>(texture & 0xFFFF) << 16
+        | static_cast<uint64_t>(geometry & 0xFFFF);
+}
+
+class RenderQueue {
+private:
+    struct Item {
+        uint64_t key;
+        uint32_t index; // posição em packets
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<Item> items;
+    std::vector<Item> scratch;
+
+public:
+    void clear() {
+        packets.clear();
+        items.clear();
+    }
+
+    void push(Pass pass, uint32_t shader, uint32_t material, uint32_t texture, uint32_t geometry, const DrawPacket& packet) {
+        uint32_t index = packets.size();
+        items.push_back({makeKey(pass, shader, material, texture, geometry, index), index});
+        packets.push_back(packet);
+    }
+
+    // Radix sort LSD estável, 8 bits por rodada. Rodadas em que todas as
+    // chaves têm o mesmo byte (passes e campos não usados) são puladas.
+    void sort() {
+        const size_t count = items.size();
+        if (count < 2) return;
+
+        size_t histogram[8][256] = {};
+        for (const Item& item : items) {
+            for (int round = 0; round < 8; round++) {
+                histogram[round][(item.key >> (round * 8)) & 0xFF]++;
+            }
+        }
+
+        scratch.resize(count);
+        for (int round = 0; round < 8; round++) {
+            size_t* buckets = histogram[round];
+            if (buckets[(items[0].key >> (round * 8)) & 0xFF] == count) continue;
+
+            size_t offset = 0;
+            for (int b = 0; b < 256; b++) {
+                size_t amount = buckets[b];
+                buckets[b] = offset;
+                offset += amount;
+            }
+            for (const Item& item : items) {
+                scratch[buckets[(item.key >> (round * 8)) & 0xFF]++] = item;
+            }
+            items.swap(scratch);
+        }
+    }
+
+    size_t size() const {
+        return items.size();
+    }
+
+    bool empty() const {
+        return items.empty();
+    }
+
+    // i-ésimo pacote na ordem atual (a de emissão até sort() ser chamado)
+    const DrawPacket& operator[](size_t i) const {
+        return packets[items[i].index];
+    }
+
+    uint64_t key(size_t i) const {
+        return items[i].key;
+    }
+};
+
+inline RenderQueue& queue() {
+    static RenderQueue instance;
+    return instance;
+}
+
+}
+
+#endif
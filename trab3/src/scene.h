@@ -7,11 +7,12 @@
 #include "shape.h"
 #include "shader.h"
 #include "transform.h"
+#include "render_queue.h"
+#include "name_table.h"
 #include "error.h"
 #include <vector>
 #include <string>
 #include <algorithm>
-#include <map>
 #include <memory>
 #include <cmath>
 #include <iostream>
@@ -29,11 +30,66 @@ using ParentPtr = std::weak_ptr<Node>; // ponteiro fraco para evitar ciclos de r
 class SceneGraph;
 using SceneGraphPtr = std::shared_ptr<SceneGraph>;
 
+// Referência estável a um nó. Ids não são reaproveitados, então um handle
+// guardado vale enquanto o nó estiver no grafo e SceneGraph::resolve é O(1).
+struct NodeHandle {
+    int id = -1;
+
+    bool valid() const {
+        return id >= 0;
+    }
+};
+
+// Entrada da travessia achatada: o nó e o índice logo depois da sua subárvore,
+// para pular a subárvore inteira de uma vez.
+struct DrawEntry {
+    Node* node;
+    int end;
+};
+
+// Nó com algo empilhado durante a travessia, e o carimbo de mundo e o shader
+// que voltam a valer depois da sua subárvore.
+struct OpenEntry {
+    Node* node;
+    int end;
+    unsigned int parent_stamp;
+    Shader* parent_shader;
+};
+
+// Envia uma fila já ordenada: troca de programa e de VAO só quando mudam entre pacotes.
+inline void submitQueue(const render::RenderQueue& queue) {
+    static const UniformHandle transform_uniform = InternUniform("M");
+    Shader* current_shader = nullptr;
+    unsigned int current_vao = 0;
+    int transformLoc = -1;
+    for (size_t i = 0; i < queue.size(); i++) {
+        const render::DrawPacket& packet = queue[i];
+        if (packet.shader != current_shader) {
+            current_shader = packet.shader;
+            current_shader->UseProgram();
+            transformLoc = current_shader->GetUniformLocation(transform_uniform);
+        }
+        if (packet.shape->GetVAO() != current_vao) {
+            current_vao = packet.shape->GetVAO();
+            glBindVertexArray(current_vao);
+        }
+        // Envia a matriz de transformação para o shader
+        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(packet.model));
+        packet.shape->DrawBound();
+    }
+    glBindVertexArray(0);
+    // O programa ativo mudou por fora da pilha de shaders
+    shaderStack().forgetLastUsed();
+    Error::Check("scene::submitQueue");
+}
+
 class Node : public std::enable_shared_from_this<Node>{ // BACALHAU falta fazer as subclasses de nó
 private:
     int id;
     inline static int next_id = 0;
+    inline static unsigned int topology_version = 0; // muda a cada alteração de filhos em qualquer nó
     std::string name;
+    names::NameHandle name_handle; // nome internado, para as buscas no SceneGraph
     ShapePtr shape;
     ShaderPtr shader;
     std::vector<NodePtr> children;
@@ -44,16 +100,36 @@ private:
     bool applicability = true;
     bool local_applicability = true;
     bool local_visibility = true;
+    render::Pass pass = render::Pass::Ordered;
+
+    // Travessia em pré-ordem da subárvore deste nó, refeita só quando a topologia muda.
+    std::vector<DrawEntry> draw_list;
+    unsigned int draw_list_version = ~0u;
+    std::vector<OpenEntry> open_entries; // nós com transformação/shader ativos durante a travessia
+
+    // Cache da matriz de mundo (pai * local). Só é recalculada quando a
+    // transformação local muda de versão ou quando o pai recalculou a dele,
+    // o que o carimbo do pai indica; subárvores paradas não multiplicam nada.
+    glm::mat4 world_matrix = glm::mat4(1.0f);
+    unsigned int world_version = 0;      // versão da transformação local usada no cache
+    unsigned int world_parent_stamp = 0; // carimbo do pai usado no cache
+    unsigned int world_stamp = 0;        // muda sempre que world_matrix é recalculada
+    inline static unsigned int next_world_stamp = 0;
+    // Matriz de base (view) do último draw a partir deste nó e o seu carimbo
+    glm::mat4 base_matrix = glm::mat4(1.0f);
+    unsigned int base_stamp = 0;
 
     
     Node(std::string name, ShapePtr shape, ShaderPtr shader, transform::TransformPtr transform) : 
     name(name), shape(shape), shader(shader), transform(transform)
     {
         id = next_id++;
+        name_handle = names::intern(name);
     }
 
     void setName(const std::string& new_name) {
         name = new_name;
+        name_handle = names::intern(new_name);
     }
 
     void setParent(NodePtr new_parent) {
@@ -80,6 +156,88 @@ private:
         applicability = new_applicability;
     }
 
+    void setPass(render::Pass new_pass) {
+        pass = new_pass;
+    }
+
+    static void appendToDrawList(std::vector<DrawEntry>& list, Node* node) {
+        int index = list.size();
+        list.push_back({node, 0});
+        for (const NodePtr& child : node->children) {
+            appendToDrawList(list, child.get());
+        }
+        list[index].end = list.size();
+    }
+
+    void updateDrawList() {
+        if (draw_list_version == topology_version) return;
+        draw_list.clear();
+        appendToDrawList(draw_list, this);
+        draw_list_version = topology_version;
+    }
+
+    // Percorre a lista achatada em vez de recursão nos filhos: sem cópias de
+    // shared_ptr por nó, e subárvores invisíveis são puladas pelo índice end.
+    // Cada forma visível vira um pacote na fila; nada é desenhado aqui.
+    void collect(render::RenderQueue& queue, bool print) {
+        updateDrawList();
+        transform::TransformStack& transform_stack = transform::stack();
+        open_entries.clear();
+        if (base_stamp == 0 || base_matrix != transform_stack.top()) {
+            base_matrix = transform_stack.top();
+            base_stamp = ++next_world_stamp;
+        }
+        unsigned int stamp = base_stamp; // carimbo da matriz no topo da pilha
+        Shader* current_shader = shaderStack().peek();
+
+        const int count = draw_list.size();
+        int i = 0;
+        while (i < count) {
+            // Fecha as subárvores que terminaram antes deste nó
+            while (!open_entries.empty() && open_entries.back().end <= i) {
+                if (open_entries.back().node->transform) transform_stack.pop();
+                stamp = open_entries.back().parent_stamp;
+                current_shader = open_entries.back().parent_shader;
+                open_entries.pop_back();
+            }
+
+            const DrawEntry& entry = draw_list[i];
+            Node* node = entry.node;
+            if (!node->applicability || !node->visibility) {
+                i = entry.end;
+                continue;
+            }
+            i++;
+            // Sem aplicabilidade local o nó só repassa o desenho para os filhos
+            if (!node->local_applicability) continue;
+
+            if (print) printf("Drawing node %s (id=%d) (parent=%s)\n", node->name.c_str(), node->id, node->parent.lock()? node->parent.lock()->getName().c_str() : "none");
+
+            if (node->transform || node->shader) open_entries.push_back({node, entry.end, stamp, current_shader});
+            if (node->transform) {
+                // Combina a transformação do pai com a local só se alguma das duas mudou
+                if (node->world_parent_stamp != stamp || node->world_version != node->transform->getVersion()) {
+                    node->world_matrix = transform_stack.top() * node->transform->getMatrix();
+                    node->world_parent_stamp = stamp;
+                    node->world_version = node->transform->getVersion();
+                    node->world_stamp = ++next_world_stamp;
+                }
+                transform_stack.pushWorld(node->world_matrix);
+                stamp = node->world_stamp;
+            }
+            if (node->shader) current_shader = node->shader.get();
+
+            if (node->local_visibility && node->shape) {
+                render::DrawPacket packet = {transform_stack.top(), node->shape.get(), current_shader};
+                queue.push(node->pass, current_shader->GetShaderID(), 0, 0, node->shape->GetVAO(), packet);
+            }
+        }
+        while (!open_entries.empty()) {
+            if (open_entries.back().node->transform) transform_stack.pop();
+            open_entries.pop_back();
+        }
+    }
+
     friend class SceneGraph;
 
 public:
@@ -112,6 +270,14 @@ public:
         return name;
     }
 
+    names::NameHandle getNameHandle() const {
+        return name_handle;
+    }
+
+    NodeHandle getHandle() const {
+        return NodeHandle{id};
+    }
+
     transform::TransformPtr getTransform() const {
         return transform;
     }
@@ -136,6 +302,10 @@ public:
         return local_visibility;
     }
 
+    render::Pass getPass() const {
+        return pass;
+    }
+
     bool getLocalApplicability() const {
         return local_applicability;
     }
@@ -192,6 +362,7 @@ public:
 
     void addChild(NodePtr child) {
         children.push_back(child);
+        topology_version++;
         child->setParent(shared_from_this());
     }
 
@@ -201,11 +372,13 @@ public:
             return;
         }
         children.insert(children.begin() + index, child);
+        topology_version++;
         child->setParent(shared_from_this());
     }
 
     void addChildFront(NodePtr child) {
         children.insert(children.begin(), child);
+        topology_version++;
         child->setParent(shared_from_this());
     }
 
@@ -213,6 +386,7 @@ public:
         auto it = std::find(children.begin(), children.end(), after);
         if (it != children.end()) {
             children.insert(it + 1, child);
+            topology_version++;
         } else {
             std::cerr << "Reference child not found in addChildAfter" << std::endl;
         }
@@ -227,6 +401,7 @@ public:
         NodePtr child = children[from_idx];
         children.erase(children.begin() + from_idx);
         children.insert(children.begin() + to_idx, child);
+        topology_version++;
     }
 
     void swapChildren(int idx1, int idx2) {
@@ -235,6 +410,7 @@ public:
             return;
         }
         std::swap(children[idx1], children[idx2]);
+        topology_version++;
     }
 
     void removeChild(NodePtr child) {
@@ -242,62 +418,20 @@ public:
         if (it != children.end()) {
             (*it)->setParent(nullptr);
             children.erase(it);
+            topology_version++;
         } else {
             std::cerr << "Child not found in removeChild" << std::endl;
         }
     }
 
+    // Monta a fila com a subárvore, ordena e envia.
     void draw(bool print = false) {
-        if (!applicability) return;
-        if (!visibility) return;
-        if (!local_applicability) {
-            // Desenha os filhos
-            for (NodePtr child : children) {
-                child->draw();
-            }
-            Error::Check("scene::Node::draw after drawing children");
-            return;
-        }
-        if (print) printf("Drawing node %s (id=%d) (parent=%s)\n", name.c_str(), id, parent.lock()? parent.lock()->getName().c_str() : "none");
-
         Error::Check("scene::Node::draw start");
-        transform::TransformStack& transform_stack = transform::stack();
-        // Combina a transformação do pai com a transformação local dentro do push
-        if (transform) transform_stack.push(transform->getMatrix());
-
-        if (shader) shaderStack().push(shader);
-
-        if (!local_visibility) {
-            // Desenha os filhos
-            for (NodePtr child : children) {
-                child->draw();
-            }
-            Error::Check("scene::Node::draw after drawing children");
-            if (transform) transform_stack.pop();
-            if (shader) shaderStack().pop();
-            Error::Check("scene::Node::draw end");
-            return;
-        }
-
-        Error::Check("scene::Node::draw before drawing shape");
-        // Desenha a forma associada a este nó, se existir
-        if (shape) {
-            
-            // Envia a matriz de transformação para o shader
-            unsigned int shader_program = shaderStack().top()->GetShaderID();
-            unsigned int transformLoc = glGetUniformLocation(shader_program, "M");
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform_stack.top()));
-            shape->Draw();
-        }
-        Error::Check("scene::Node::draw after drawing shape");
-        // Desenha os filhos
-        for (NodePtr child : children) {
-            child->draw(print);
-        }
-        Error::Check("scene::Node::draw after drawing children");
-        if (transform) transform_stack.pop();
-        if (shader) shaderStack().pop();
-        Error::Check("scene::Node::draw end");
+        render::RenderQueue& queue = render::queue();
+        queue.clear();
+        collect(queue, print);
+        queue.sort();
+        submitQueue(queue);
     }
 };
 
@@ -305,8 +439,8 @@ class SceneGraph {
 private:
     NodePtr root;
     ShaderPtr base_shader;
-    std::map<std::string, NodePtr> name_map; // Mapa de nomes para nós
-    std::map<int, NodePtr> node_map; // Mapa de IDs para nós
+    names::IdMap<NodePtr> name_map; // Mapa de nomes internados para nós
+    names::IdMap<NodePtr> node_map; // Mapa de IDs para nós
     NodePtr currentNode; // Nó atualmente selecionado
     transform::TransformPtr view_transform;
 
@@ -315,8 +449,8 @@ private:
         root = Node::Make("root", nullptr, base, transform::Transform::Make());
         base_shader = base;
         currentNode = root;
-        name_map["root"] = root;
-        node_map[root->getId()] = root;
+        name_map.insert(root->getNameHandle().id, root);
+        node_map.insert(root->getId(), root);
         view_transform = transform::Transform::Make();
         view_transform->orthographic(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f); // Inicializa com ortográfica padrão
     }
@@ -324,11 +458,28 @@ private:
     friend SceneGraphPtr graph();
 
     void registerNode(NodePtr node) {
-        name_map[node->getName()] = node;
-        node_map[node->getId()] = node;
+        name_map.insert(node->getNameHandle().id, node);
+        node_map.insert(node->getId(), node);
         currentNode = node;
     }
 
+    // Busca sem efeito colateral no currentNode. Um nome que nunca foi
+    // internado não pode estar no grafo, então nem entra na tabela de nomes.
+    NodePtr findByName(const std::string& name) const {
+        names::NameHandle handle = names::table().find(name);
+        if (!handle.valid()) return nullptr;
+        return findByName(handle);
+    }
+
+    NodePtr findByName(names::NameHandle name) const {
+        const NodePtr* node = name_map.find(name.id);
+        return node ? *node : nullptr;
+    }
+
+    bool hasName(const std::string& name) const {
+        return findByName(name) != nullptr;
+    }
+
 protected:
 
     // BACALHAU
@@ -341,18 +492,17 @@ protected:
     // }
 
     NodePtr getNodeByName(const std::string& name) {
-        auto it = name_map.find(name);
-        if (it != name_map.end()) {
-            currentNode = it->second;
-            return currentNode;
+        NodePtr node = findByName(name);
+        if (node) {
+            currentNode = node;
         }
-        return nullptr;
+        return node;
     }
 
     NodePtr getNodeById(int id) {
-        auto it = node_map.find(id);
-        if (it != node_map.end()) {
-            currentNode = it->second;
+        const NodePtr* node = node_map.find(id);
+        if (node) {
+            currentNode = *node;
             return currentNode;
         }
         return nullptr;
@@ -360,6 +510,23 @@ protected:
 
 public:
 
+    // Handle para guardar e resolver depois sem busca por string; inválido se o nome não existe.
+    NodeHandle getHandle(const std::string& name) const {
+        NodePtr node = findByName(name);
+        return node ? node->getHandle() : NodeHandle();
+    }
+
+    NodeHandle getHandle(names::NameHandle name) const {
+        NodePtr node = findByName(name);
+        return node ? node->getHandle() : NodeHandle();
+    }
+
+    // Nó do handle, ou nullptr se ele saiu do grafo. Não muda o currentNode.
+    NodePtr resolve(NodeHandle handle) const {
+        const NodePtr* node = node_map.find(handle.id);
+        return node ? *node : nullptr;
+    }
+
     NodePtr getCurrentNode() const {
         return currentNode;
     }
@@ -373,7 +540,7 @@ public:
     }
 
     void addNode(const std::string& name, ShapePtr shape = nullptr, ShaderPtr shader = nullptr, transform::TransformPtr transform = nullptr, NodePtr parent = nullptr) {
-        if (name_map.find(name) != name_map.end()) {
+        if (hasName(name)) {
             std::cerr << "Node with name " << name << " already exists!" << std::endl;
             return;
         }
@@ -397,6 +564,15 @@ public:
         }
     }
 
+    void lookAtNode(NodeHandle handle) {
+        NodePtr node = resolve(handle);
+        if (node) {
+            currentNode = node;
+        } else {
+            std::cerr << "Node with id " << handle.id << " not found!" << std::endl;
+        }
+    }
+
     void lookAtNode(int id) {
         NodePtr node = getNodeById(id);
         if (node) {
@@ -418,6 +594,11 @@ public:
         currentNode->setTransform(transform);
     }
 
+    // Formas em Pass::Sorted são agrupadas por estado em vez de seguir a ordem da cena
+    void setCurrentNodePass(render::Pass pass) {
+        currentNode->setPass(pass);
+    }
+
     void moveCurrentNodeTo(NodePtr new_parent) {
         if (new_parent) {
             NodePtr old_parent = currentNode->getParent();
@@ -465,13 +646,13 @@ public:
     }
 
     void renameCurrentNode(const std::string& new_name) {
-        if (name_map.find(new_name) != name_map.end()) {
+        if (hasName(new_name)) {
             std::cerr << "Node with name " << new_name << " already exists!" << std::endl;
             return;
         }
-        name_map.erase(currentNode->getName());
+        name_map.erase(currentNode->getNameHandle().id);
         currentNode->setName(new_name);
-        name_map[new_name] = currentNode;
+        name_map.insert(currentNode->getNameHandle().id, currentNode);
     }
 
     void removeCurrentNode() {
@@ -479,7 +660,7 @@ public:
         if (parent) {
             parent->removeChild(currentNode);
         }
-        name_map.erase(currentNode->getName());
+        name_map.erase(currentNode->getNameHandle().id);
         node_map.erase(currentNode->getId());
     }
 
@@ -494,8 +675,8 @@ public:
                 node->getParent()
             );
             node->getParent()->addChild(new_node);
-            name_map[new_name] = new_node;
-            node_map[new_node->getId()] = new_node;
+            name_map.insert(new_node->getNameHandle().id, new_node);
+            node_map.insert(new_node->getId(), new_node);
             currentNode = new_node;
         } else {
             std::cerr << "Node with name " << name << " not found!" << std::endl;
@@ -648,8 +829,8 @@ public:
         currentNode = root;
         name_map.clear();
         node_map.clear();
-        name_map["root"] = root;
-        node_map[root->getId()] = root;
+        name_map.insert(root->getNameHandle().id, root);
+        node_map.insert(root->getId(), root);
     }
 
     
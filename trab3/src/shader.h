@@ -11,6 +11,8 @@ using ShaderPtr = std::shared_ptr<Shader>;
 #include <iostream>
 #include <sstream> 
 #include <cstdlib>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 static GLuint MakeShader(GLenum shadertype, const std::string& filename) {
@@ -65,8 +67,56 @@ static GLuint MakeShader(GLenum shadertype, const std::string& filename) {
     return id;
 }
 
+// Nome de uniform internado: a string só é procurada uma vez, em InternUniform,
+// e o handle vira um índice direto na tabela de locations de cada Shader.
+struct UniformHandle {
+    int index;
+};
+
+inline std::vector<std::string>& internedUniformNames() {
+    static std::vector<std::string> names;
+    return names;
+}
+
+inline UniformHandle InternUniform(const std::string& name) {
+    static std::unordered_map<std::string, int> ids;
+    auto it = ids.find(name);
+    if (it != ids.end()) return {it->second};
+    int index = internedUniformNames().size();
+    internedUniformNames().push_back(name);
+    ids[name] = index;
+    return {index};
+}
+
 class Shader {
     unsigned int m_pid;
+    std::unordered_map<std::string, int> uniform_locations; // preenchido no Link()
+    std::vector<int> handle_locations; // indexado por UniformHandle::index
+    static constexpr int UNRESOLVED = -2;
+
+    // Guarda a location de todos os uniforms ativos do programa recém-linkado.
+    void CacheUniformLocations() {
+        uniform_locations.clear();
+        handle_locations.clear();
+        GLint count = 0;
+        GLint max_length = 0;
+        glGetProgramiv(m_pid, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(m_pid, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+        std::vector<char> name(max_length + 1);
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(m_pid, i, name.size(), &length, &size, &type, name.data());
+            std::string uniform_name(name.data(), length);
+            int location = glGetUniformLocation(m_pid, uniform_name.c_str());
+            uniform_locations[uniform_name] = location;
+            // arrays aparecem como "nome[0]"; aceita também só "nome"
+            size_t bracket = uniform_name.find('[');
+            if (bracket != std::string::npos) uniform_locations[uniform_name.substr(0, bracket)] = location;
+        }
+        Error::Check("cache uniform locations");
+    }
 protected:
     Shader() {
         m_pid = glCreateProgram();
@@ -111,6 +161,23 @@ public:
             delete[] message;
             exit(1);
         }
+        CacheUniformLocations();
+    }
+
+    // Location guardada no Link(), ou -1 se o programa não tem esse uniform.
+    int GetUniformLocation(const std::string& name) const {
+        auto it = uniform_locations.find(name);
+        return it != uniform_locations.end() ? it->second : -1;
+    }
+
+    // Versão para o caminho quente: só um índice depois da primeira consulta.
+    int GetUniformLocation(UniformHandle handle) {
+        if (handle.index >= (int)handle_locations.size()) {
+            handle_locations.resize(internedUniformNames().size(), UNRESOLVED);
+        }
+        int& location = handle_locations[handle.index];
+        if (location == UNRESOLVED) location = GetUniformLocation(internedUniformNames()[handle.index]);
+        return location;
     }
     void UseProgram() const {
         glUseProgram(m_pid);
@@ -118,7 +185,7 @@ public:
 };
 
 class ShaderStack { // singleton
-    // BACALHAU falta adaptar para ter o batching dos comandos de draw pelo shader
+    // o batching dos comandos de draw pelo shader fica na fila de renderização (render_queue.h)
 private:
     std::vector<ShaderPtr> stack;
     ShaderPtr last_used_shader;
@@ -162,6 +229,14 @@ public:
     ShaderPtr getLastUsedShader() const {
         return last_used_shader;
     }
+    // Topo da pilha sem ativar o programa
+    Shader* peek() const {
+        return stack.back().get();
+    }
+    // Para quando alguém trocou o programa ativo sem passar pela pilha
+    void forgetLastUsed() {
+        last_used_shader = nullptr;
+    }
 };
 
 inline ShaderStack& shaderStack() {
@@ -90,7 +90,18 @@ public:
         glDeleteVertexArrays(1, &m_vao);
     }
 
-    // Função de desenho
+    unsigned int GetVAO() const {
+        return m_vao;
+    }
+
+    // Desenha com o VAO já ligado por quem chama. É o que a fila de
+    // renderização chama no lugar de Draw(), então quem sobrescreve Draw()
+    // também deve sobrescrever DrawBound().
+    virtual void DrawBound() const {
+        glDrawElements(mode, n_indices, type, (void*)0);
+    }
+
+    // Função de desenho, fora da fila (ver DrawBound)
     virtual void Draw() {
         glBindVertexArray(m_vao);
         // Desenha índices (3*(nverts-2))
@@ -20,6 +20,10 @@ const double updateInterval = 1.0/60.0; // 60 fps
 float contador_rotacao_terra = 0;
 float contador_rotacao_lua = 0;
 
+// handles dos nós animados, guardados quando a cena é montada
+scene::NodeHandle handle_rotacao_terra;
+scene::NodeHandle handle_rotacao_lua;
+
 int contador_debug = 0;
 
     #include <chrono>
@@ -80,6 +84,7 @@ static void initialize()
   sg->translateCurrentNode(0.7f, 0.0f, 0.0f);
 
   sg->newNodeAbove("rotacao_terra");
+  handle_rotacao_terra = sg->getCurrentNode()->getHandle();
 
   std::cout << contador_debug++ << ": " << sg->getCurrentNode()->getName() << std::endl; // DEBUG
 
@@ -109,12 +114,21 @@ static void initialize()
   sg->translateCurrentNode(-0.2f, 0.0f, 0.0f);
 
   sg->newNodeAbove("rotacao_lua");
+  handle_rotacao_lua = sg->getCurrentNode()->getHandle();
 
   std::cout << contador_debug++ << ": " << sg->getCurrentNode()->getName() << std::endl; // DEBUG
 
   Error::Check("initialize");
 }
 
+// Olha para o nó do handle. Se ele saiu do grafo (clearGraph e a cena foi
+// remontada), busca de novo pelo nome e guarda o handle novo.
+static void lookAtNode(scene::NodeHandle& handle, const std::string& name)
+{
+  if (!sg->resolve(handle)) handle = sg->getHandle(name);
+  sg->lookAtNode(handle);
+}
+
 static void display(GLFWwindow * win)
 {
   glFlush();
@@ -124,12 +138,13 @@ static void display(GLFWwindow * win)
   // atualiza geometria dinâmica
   Error::Check("display - antes de atualizar geometria dinâmica");
 
-  sg->lookAtNode("rotacao_terra");
+  // a cada quadro a busca é só pelo id
+  lookAtNode(handle_rotacao_terra, "rotacao_terra");
   sg->rotateCurrentNode(0.1f, 0,0,1);
   // contador_rotacao_terra = (contador_rotacao_terra + 1.0f);
   // printf("\ncontador_rotacao_terra: %f\n", contador_rotacao_terra);
 
-  sg->lookAtNode("rotacao_lua");
+  lookAtNode(handle_rotacao_lua, "rotacao_lua");
   sg->rotateCurrentNode(0.5f, 0,0,1);
   // contador_rotacao_lua = (contador_rotacao_lua + 5.0f);
   // printf("contador_rotacao_lua: %f\n", contador_rotacao_lua);
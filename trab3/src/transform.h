@@ -21,13 +21,25 @@ using TransformStackPtr = std::shared_ptr<TransformStack>;
 
 class Transform {
     glm::mat4 matrix; // Matriz de transformação 4x4
+    // Versão da matriz, única entre todas as transformações: os nós comparam
+    // com a versão usada no cache da matriz de mundo para saber se mudou.
+    unsigned int version;
+    inline static unsigned int next_version = 0;
+
+    void touch() {
+        version = ++next_version;
+    }
+
     Transform() {
         // Inicializa a matriz como identidade
         matrix = glm::mat4(1.0f);
+        touch();
     }
     Transform(glm::mat4 matrix) :
         matrix(matrix)
-    {}
+    {
+        touch();
+    }
     public:
         static TransformPtr Make() {
             return TransformPtr(new Transform());
@@ -43,20 +55,28 @@ class Transform {
             return matrix;
         }
 
+        unsigned int getVersion() const {
+            return version;
+        }
+
         void reset() {
             matrix = glm::mat4(1.0f);
+            touch();
         }
 
         void setMatrix(glm::mat4 matrix) {
             this->matrix = matrix;
+            touch();
         }
 
         void multiply(const glm::mat4& other) {
             matrix = matrix * other;
+            touch();
         }
 
         void translate(float x, float y, float z) {
             matrix = matrix * glm::translate(matrix, glm::vec3(x, y, z));
+            touch();
         }
 
         void setTranslate(float x, float y, float z) {
@@ -73,6 +93,7 @@ class Transform {
                 axis = glm::normalize(axis);
             }
             matrix = glm::rotate(matrix, angle_radians, axis);
+            touch();
         }
 
         void setRotate(float angle_degrees, float axis_x, float axis_y, float axis_z) {
@@ -82,6 +103,7 @@ class Transform {
 
         void scale(float x, float y, float z) {
             matrix = matrix * glm::scale(matrix, glm::vec3(x, y, z));
+            touch();
         }
 
         void setScale(float x, float y, float z) {
@@ -91,6 +113,7 @@ class Transform {
 
         void orthographic(float left, float right, float bottom, float top, float near, float far) {
             matrix = glm::ortho(left, right, bottom, top, near, far);
+            touch();
         }
 };
 
@@ -116,6 +139,11 @@ public:
         stack.push_back(top() * matrix_to_apply);
     }
 
+    // Empilha uma matriz que já inclui as transformações dos pais (cache de mundo).
+    void pushWorld(const glm::mat4& world_matrix) {
+        stack.push_back(world_matrix);
+    }
+
     void pop() {
         if (stack.size() > 1) {
             stack.pop_back();